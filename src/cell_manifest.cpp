@@ -0,0 +1,140 @@
+#include "cell_manifest.hpp"
+#include "platform.hpp"
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace ply2lcc {
+
+static constexpr uint32_t MANIFEST_MAGIC = 0x4d4c3250;  // "P2LM"
+static constexpr uint32_t MANIFEST_VERSION = 1;
+
+template <typename T>
+static void write_pod(std::ostream& out, const T& v) {
+    out.write(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+
+template <typename T>
+static bool read_pod(std::istream& in, T& v) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&v), sizeof(T)));
+}
+
+static void file_stamp(const fs::path& path, uint64_t& size, int64_t& mtime) {
+    std::error_code ec;
+    size = fs::exists(path, ec) ? fs::file_size(path, ec) : 0;
+    mtime = size > 0 ? static_cast<int64_t>(fs::last_write_time(path, ec).time_since_epoch().count()) : 0;
+}
+
+CellManifest CellManifest::from_data(const LccData& data) {
+    CellManifest manifest;
+
+    std::map<uint64_t, uint64_t> hashes;
+    for (const auto& cell : data.cells) {
+        hashes[make_key(cell.cell_id, cell.lod)] = cell.hash;
+    }
+
+    uint64_t data_offset = 0;
+    uint64_t sh_offset = 0;
+    auto units = data.build_index(data_offset, sh_offset);
+
+    for (const auto& unit : units) {
+        for (size_t lod = 0; lod < unit.lods.size(); ++lod) {
+            const LccNodeInfo& node = unit.lods[lod];
+            if (node.splat_count == 0) continue;
+
+            CellManifestEntry e;
+            e.cell_id = unit.index;
+            e.lod = static_cast<uint32_t>(lod);
+            e.hash = hashes[make_key(unit.index, lod)];
+            e.count = node.splat_count;
+            e.data_offset = node.data_offset;
+            e.data_size = node.data_size;
+            e.sh_offset = node.sh_offset;
+            e.sh_size = node.sh_size;
+            manifest.entries_[make_key(e.cell_id, lod)] = e;
+        }
+    }
+
+    return manifest;
+}
+
+bool CellManifest::load(const fs::path& path) {
+    entries_.clear();
+
+    auto in = platform::ifstream_open(path);
+    if (!in) return false;
+
+    uint32_t magic = 0, version = 0;
+    uint64_t num_entries = 0;
+    if (!read_pod(in, magic) || magic != MANIFEST_MAGIC) return false;
+    if (!read_pod(in, version) || version != MANIFEST_VERSION) return false;
+    if (!read_pod(in, data_file_size_) || !read_pod(in, data_mtime_) ||
+        !read_pod(in, sh_file_size_) || !read_pod(in, sh_mtime_) ||
+        !read_pod(in, num_entries)) {
+        return false;
+    }
+
+    for (uint64_t i = 0; i < num_entries; ++i) {
+        CellManifestEntry e;
+        if (!read_pod(in, e.cell_id) || !read_pod(in, e.lod) || !read_pod(in, e.hash) ||
+            !read_pod(in, e.count) || !read_pod(in, e.data_offset) || !read_pod(in, e.data_size) ||
+            !read_pod(in, e.sh_offset) || !read_pod(in, e.sh_size)) {
+            entries_.clear();
+            return false;
+        }
+        entries_[make_key(e.cell_id, e.lod)] = e;
+    }
+    return true;
+}
+
+bool CellManifest::save(const fs::path& path) const {
+    std::error_code ec;
+    if (path.has_parent_path()) {
+        fs::create_directories(path.parent_path(), ec);
+    }
+
+    auto out = platform::ofstream_open(path);
+    if (!out) return false;
+
+    write_pod(out, MANIFEST_MAGIC);
+    write_pod(out, MANIFEST_VERSION);
+    write_pod(out, data_file_size_);
+    write_pod(out, data_mtime_);
+    write_pod(out, sh_file_size_);
+    write_pod(out, sh_mtime_);
+    write_pod(out, static_cast<uint64_t>(entries_.size()));
+
+    for (const auto& [key, e] : entries_) {
+        write_pod(out, e.cell_id);
+        write_pod(out, e.lod);
+        write_pod(out, e.hash);
+        write_pod(out, e.count);
+        write_pod(out, e.data_offset);
+        write_pod(out, e.data_size);
+        write_pod(out, e.sh_offset);
+        write_pod(out, e.sh_size);
+    }
+    return static_cast<bool>(out);
+}
+
+void CellManifest::record_files(const fs::path& data_path, const fs::path& sh_path) {
+    file_stamp(data_path, data_file_size_, data_mtime_);
+    file_stamp(sh_path, sh_file_size_, sh_mtime_);
+}
+
+bool CellManifest::matches_files(const fs::path& data_path, const fs::path& sh_path) const {
+    uint64_t data_size = 0, sh_size = 0;
+    int64_t data_mtime = 0, sh_mtime = 0;
+    file_stamp(data_path, data_size, data_mtime);
+    file_stamp(sh_path, sh_size, sh_mtime);
+
+    return data_size == data_file_size_ && data_mtime == data_mtime_ &&
+           sh_size == sh_file_size_ && sh_mtime == sh_mtime_;
+}
+
+const CellManifestEntry* CellManifest::find(uint32_t cell_id, size_t lod) const {
+    auto it = entries_.find(make_key(cell_id, lod));
+    return it == entries_.end() ? nullptr : &it->second;
+}
+
+} // namespace ply2lcc
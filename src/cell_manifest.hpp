@@ -0,0 +1,58 @@
+#ifndef PLY2LCC_CELL_MANIFEST_HPP
+#define PLY2LCC_CELL_MANIFEST_HPP
+
+#include "lcc_types.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <map>
+
+namespace ply2lcc {
+
+// Where one cell/LOD landed in data.bin/shcoef.bin, plus its input content hash
+struct CellManifestEntry {
+    uint32_t cell_id = 0;
+    uint32_t lod = 0;
+    uint64_t hash = 0;
+    uint32_t count = 0;
+    uint64_t data_offset = 0;
+    uint32_t data_size = 0;
+    uint64_t sh_offset = 0;
+    uint32_t sh_size = 0;
+};
+
+// Per-cell manifest written beside the output in incremental mode.
+// On rerun, cells whose hash is unchanged are copied from the previous output.
+class CellManifest {
+public:
+    // Build from LccData after sort_cells(); offsets match LccWriter's layout
+    static CellManifest from_data(const LccData& data);
+
+    bool load(const std::filesystem::path& path);
+    bool save(const std::filesystem::path& path) const;
+
+    // Remember size/mtime of the output files this manifest describes
+    void record_files(const std::filesystem::path& data_path,
+                      const std::filesystem::path& sh_path);
+
+    // True if the files on disk are still the ones recorded by record_files()
+    bool matches_files(const std::filesystem::path& data_path,
+                       const std::filesystem::path& sh_path) const;
+
+    const CellManifestEntry* find(uint32_t cell_id, size_t lod) const;
+    size_t size() const { return entries_.size(); }
+
+private:
+    static uint64_t make_key(uint32_t cell_id, size_t lod) {
+        return (static_cast<uint64_t>(cell_id) << 32) | static_cast<uint64_t>(lod);
+    }
+
+    std::map<uint64_t, CellManifestEntry> entries_;
+    uint64_t data_file_size_ = 0;
+    uint64_t sh_file_size_ = 0;
+    int64_t data_mtime_ = 0;
+    int64_t sh_mtime_ = 0;
+};
+
+} // namespace ply2lcc
+
+#endif // PLY2LCC_CELL_MANIFEST_HPP
@@ -0,0 +1,122 @@
+#include "cell_size_tuner.hpp"
+#include "rate_control.hpp"
+#include "splat_buffer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace ply2lcc {
+
+namespace {
+
+// Per-cell splat counts of the sample for one cell size, scaled to the full input
+class CellHistogram {
+public:
+    CellHistogram(std::vector<float> xs, std::vector<float> ys, double scale)
+        : m_xs(std::move(xs)), m_ys(std::move(ys)), m_scale(scale) {
+        m_min_x = *std::min_element(m_xs.begin(), m_xs.end());
+        m_min_y = *std::min_element(m_ys.begin(), m_ys.end());
+        m_ids.resize(m_xs.size());
+    }
+
+    CellSizePrediction predict(float cell_size, float percentile) {
+        const double inv = 1.0 / cell_size;
+        for (size_t i = 0; i < m_xs.size(); ++i) {
+            auto cx = static_cast<uint64_t>((m_xs[i] - m_min_x) * inv);
+            auto cy = static_cast<uint64_t>((m_ys[i] - m_min_y) * inv);
+            m_ids[i] = (cy << 32) | cx;
+        }
+        std::sort(m_ids.begin(), m_ids.end());
+
+        m_counts.clear();
+        for (size_t begin = 0; begin < m_ids.size();) {
+            size_t end = begin + 1;
+            while (end < m_ids.size() && m_ids[end] == m_ids[begin]) ++end;
+            m_counts.push_back(end - begin);
+            begin = end;
+        }
+        std::sort(m_counts.begin(), m_counts.end());
+
+        auto scaled = [this](size_t count) {
+            return static_cast<size_t>(std::llround(static_cast<double>(count) * m_scale));
+        };
+        const size_t n = m_counts.size();
+        const auto rank = static_cast<size_t>(std::ceil(percentile / 100.0 * static_cast<double>(n)));
+
+        CellSizePrediction prediction;
+        prediction.cell_size = cell_size;
+        prediction.cells = n;
+        prediction.median = scaled(m_counts[n / 2]);
+        prediction.at_percentile = scaled(m_counts[std::min(n - 1, rank > 0 ? rank - 1 : 0)]);
+        prediction.max = scaled(m_counts.back());
+        return prediction;
+    }
+
+private:
+    std::vector<float> m_xs, m_ys;
+    double m_scale;
+    float m_min_x, m_min_y;
+    std::vector<uint64_t> m_ids;
+    std::vector<size_t> m_counts;
+};
+
+} // namespace
+
+CellSizePrediction tune_cell_size(const std::filesystem::path& lod0, const AutoCellSize& tuning,
+                                  const SplatTransform& transform) {
+    SplatBuffer splats;
+    if (!splats.initialize(lod0, &transform)) {
+        throw std::runtime_error("Failed to read " + lod0.u8string() + ": " + splats.error());
+    }
+
+    size_t target = tuning.splats_per_cell;
+    if (tuning.bytes_per_cell > 0) {
+        target = static_cast<size_t>(tuning.bytes_per_cell / output_bytes_per_splat(splats.num_f_rest() > 0));
+    }
+    target = std::max<size_t>(target, 1);
+
+    const size_t stride = std::max<size_t>(1, splats.size() / std::max<size_t>(1, tuning.sample_size));
+    std::vector<float> xs, ys;
+    xs.reserve(splats.size() / stride + 1);
+    ys.reserve(splats.size() / stride + 1);
+    size_t sampled = 0;
+    for (size_t i = 0; i < splats.size(); i += stride, ++sampled) {
+        const Vec3f& p = splats.pos(i);
+        if (!std::isfinite(p.x) || !std::isfinite(p.y)) continue;
+        xs.push_back(p.x);
+        ys.push_back(p.y);
+    }
+    if (xs.empty()) {
+        throw std::runtime_error("Cannot tune cell size: " + lod0.u8string() + " has no finite positions");
+    }
+
+    const float extent = std::max(*std::max_element(xs.begin(), xs.end()) - *std::min_element(xs.begin(), xs.end()),
+                                  *std::max_element(ys.begin(), ys.end()) - *std::min_element(ys.begin(), ys.end()));
+    // Each sampled row stands for `stride` rows; non-finite ones are not counted
+    const double scale = static_cast<double>(splats.size()) / static_cast<double>(sampled);
+    CellHistogram histogram(std::move(xs), std::move(ys), scale);
+
+    // Largest size that fits: one cell over the whole extent, down to the
+    // 16-bit cell coordinate limit
+    double hi = std::max(1.01 * extent, 1e-3);
+    double lo = std::max(static_cast<double>(extent) / 65535.0, 1e-4);
+    CellSizePrediction best = histogram.predict(static_cast<float>(hi), tuning.percentile);
+    if (best.at_percentile > target) {
+        best = histogram.predict(static_cast<float>(lo), tuning.percentile);
+        for (int iter = 0; iter < 24 && hi / lo > 1.01; ++iter) {
+            const double mid = std::sqrt(lo * hi);
+            CellSizePrediction p = histogram.predict(static_cast<float>(mid), tuning.percentile);
+            if (p.at_percentile <= target) {
+                lo = mid;
+                best = p;
+            } else {
+                hi = mid;
+            }
+        }
+    }
+    best.target = target;
+    return best;
+}
+
+} // namespace ply2lcc
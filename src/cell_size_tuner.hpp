@@ -0,0 +1,30 @@
+#ifndef PLY2LCC_CELL_SIZE_TUNER_HPP
+#define PLY2LCC_CELL_SIZE_TUNER_HPP
+
+#include "types.hpp"
+#include <cstddef>
+#include <filesystem>
+
+namespace ply2lcc {
+
+// Predicted LOD0 layout for a square cell size
+struct CellSizePrediction {
+    float cell_size = 0.0f;  // meters
+    size_t target = 0;       // splats per cell aimed for at the percentile
+    size_t cells = 0;        // non-empty cells
+    size_t median = 0;       // splats per cell
+    size_t at_percentile = 0;
+    size_t max = 0;
+};
+
+// Pick the largest square cell size whose per-cell LOD0 splat count at
+// `tuning.percentile` (over non-empty cells) stays within the target. Counts
+// come from an evenly strided sample of LOD0 scaled to the full row count;
+// the size is found by bisection in log space. Positions are taken in the
+// frame `transform` rotates LOD0 into.
+CellSizePrediction tune_cell_size(const std::filesystem::path& lod0, const AutoCellSize& tuning,
+                                  const SplatTransform& transform = {});
+
+} // namespace ply2lcc
+
+#endif // PLY2LCC_CELL_SIZE_TUNER_HPP
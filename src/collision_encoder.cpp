@@ -425,6 +425,9 @@ CollisionData CollisionEncoder::encode(const std::filesystem::path& mesh_path,
     if (!read_mesh(mesh_path, vertices, faces)) {
         return data;
     }
+    if (transform_.rotates()) {
+        for (auto& v : vertices) v = transform_.apply_pos(v);
+    }
 
     log("Partitioning mesh...\n");
     partition_by_cell(vertices, faces, cell_size_x, cell_size_y, scene_bbox, data.cells);
@@ -19,6 +19,9 @@ public:
 
     void set_log_callback(LogCallback cb) { log_cb_ = std::move(cb); }
 
+    // Rotate the mesh into the splats' frame (see SpatialGrid::transform)
+    void set_transform(const SplatTransform& transform) { transform_ = transform; }
+
 private:
     void log(const std::string& msg);
 
@@ -47,6 +50,7 @@ private:
     void build_bvh(CollisionCell& cell);
 
     LogCallback log_cb_;
+    SplatTransform transform_;
 };
 
 } // namespace ply2lcc
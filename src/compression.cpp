@@ -152,10 +152,26 @@ void encode_splat_view(const SplatView& sv,
                        bool has_sh) {
     size_t data_offset = data_buf.size();
     data_buf.resize(data_offset + 32);
-    uint8_t* data_ptr = data_buf.data() + data_offset;
+
+    uint8_t* sh_ptr = nullptr;
+    if (has_sh) {
+        size_t sh_offset = sh_buf.size();
+        sh_buf.resize(sh_offset + 64);
+        sh_ptr = sh_buf.data() + sh_offset;
+    }
+
+    encode_splat_view(sv, data_buf.data() + data_offset, sh_ptr, ranges, has_sh);
+}
+
+void encode_splat_view(const SplatView& sv,
+                       uint8_t* data_out,
+                       uint8_t* sh_out,
+                       const AttributeRanges& ranges,
+                       bool has_sh) {
+    uint8_t* data_ptr = data_out;
 
     // Position (12 bytes)
-    const Vec3f& pos = sv.pos();
+    const Vec3f pos = sv.pos();
     std::memcpy(data_ptr, &pos.x, 12);
     data_ptr += 12;
 
@@ -173,7 +189,7 @@ void encode_splat_view(const SplatView& sv,
     data_ptr += 6;
 
     // Rotation (4 bytes)
-    const Quat& rot = sv.rot();
+    const Quat rot = sv.rot();
     float rot_arr[4] = {rot.w, rot.x, rot.y, rot.z};
     uint32_t rot_enc = encode_rotation(rot_arr);
     std::memcpy(data_ptr, &rot_enc, 4);
@@ -185,14 +201,12 @@ void encode_splat_view(const SplatView& sv,
 
     // SH coefficients (64 bytes)
     if (has_sh) {
-        size_t sh_offset = sh_buf.size();
-        sh_buf.resize(sh_offset + 64);
-        uint8_t* sh_ptr = sh_buf.data() + sh_offset;
-
         // Copy f_rest to array
+        float scratch[MAX_F_REST];
+        const float* coeffs = sv.sh_rest(scratch);
         float f_rest[45];
         for (int i = 0; i < sv.num_f_rest() && i < 45; ++i) {
-            f_rest[i] = sv.f_rest(i);
+            f_rest[i] = coeffs[i];
         }
         for (int i = sv.num_f_rest(); i < 45; ++i) {
             f_rest[i] = 0.0f;
@@ -200,7 +214,7 @@ void encode_splat_view(const SplatView& sv,
 
         uint32_t sh_enc[16];
         encode_sh_coefficients(f_rest, ranges.sh_min.x, ranges.sh_max.x, sh_enc);
-        std::memcpy(sh_ptr, sh_enc, 64);
+        std::memcpy(sh_out, sh_enc, 64);
     }
 }
 
@@ -45,6 +45,14 @@ void encode_splat_view(const SplatView& sv,
                        const AttributeRanges& ranges,
                        bool has_sh);
 
+// Encode a single splat in place
+// data_out: 32 bytes; sh_out: 64 bytes (only written if has_sh)
+void encode_splat_view(const SplatView& sv,
+                       uint8_t* data_out,
+                       uint8_t* sh_out,
+                       const AttributeRanges& ranges,
+                       bool has_sh);
+
 } // namespace ply2lcc
 
 #endif // PLY2LCC_COMPRESSION_HPP
@@ -1,20 +1,39 @@
 #include "convert_app.hpp"
 #include "config.h"
 #include "spatial_grid.hpp"
+#include "splat_buffer.hpp"
+#include "splat_order.hpp"
+#include "lod_builder.hpp"
+#include "floater_filter.hpp"
+#include "rate_control.hpp"
+#include "cell_size_tuner.hpp"
 #include "grid_encoder.hpp"
 #include "lcc_writer.hpp"
+#include "cell_manifest.hpp"
 #include "collision_encoder.hpp"
+#include "platform.hpp"
 
 #include <iostream>
 #include <filesystem>
 #include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
 #include <regex>
+#include <sstream>
 #include <stdexcept>
+#include <omp.h>
 
 namespace fs = std::filesystem;
 
 namespace ply2lcc {
 
+static constexpr float DEFAULT_PRUNE_OPACITY = 1.0f / 255.0f;
+static constexpr float DEFAULT_PRUNE_SCALE = 0.001f;
+static constexpr int DEFAULT_FLOATER_K = 16;
+static constexpr float DEFAULT_ENV_RADIUS_FACTOR = 3.0f;
+static constexpr int64_t MAX_TILES = 65536;
+
 ConvertApp::ConvertApp(int argc, char** argv)
     : argc_(argc), argv_(argv) {}
 
@@ -24,7 +43,34 @@ ConvertApp::ConvertApp(const ConvertConfig& config)
     , output_dir_(config.output_dir)
     , cell_size_x_(config.cell_size_x)
     , cell_size_y_(config.cell_size_y)
+    , auto_cell_size_(config.auto_cell_size)
     , single_lod_(config.single_lod)
+    , use_grid_cache_(config.use_grid_cache)
+    , incremental_(config.incremental)
+    , scatter_encode_(config.scatter_encode)
+    , prefetch_distance_(config.prefetch_distance)
+    , stage_rows_(config.stage_rows)
+    , splat_order_(config.splat_order)
+    , cell_layout_(config.cell_layout)
+    , lod_major_(config.lod_major)
+    , lod_levels_(config.lod_levels)
+    , lod_budgets_(config.lod_budgets)
+    , prune_(config.prune)
+    , floaters_(config.floaters)
+    , env_separation_(config.env_separation)
+    , robust_(config.robust)
+    , layer_height_(config.layer_height)
+    , tiling_(config.tiling)
+    , transform_(config.transform)
+    , crop_(config.crop)
+    , workers_(config.workers)
+    , worker_launcher_(config.worker_launcher)
+    , worker_executable_(config.worker_executable)
+    , threads_(config.threads)
+    , max_splats_(config.max_splats)
+    , target_size_(config.target_size)
+    , sh_mode_(config.sh_mode)
+    , sh_threshold_(config.sh_threshold)
     , include_env_(config.include_env)
     , include_collision_(config.include_collision)
     , include_poses_(config.include_poses)
@@ -32,6 +78,10 @@ ConvertApp::ConvertApp(const ConvertConfig& config)
     , collision_file_(config.collision_path)
     , poses_file_(config.poses_path)
 {
+    if (workers_ > 1 && worker_executable_.empty()) {
+        throw std::runtime_error("workers > 1 needs worker_executable, the ply2lcc command-line program");
+    }
+
     // Derive input_dir_ and base_name_ from input_path_
     if (fs::is_directory(input_path_)) {
         input_dir_ = input_path_;
@@ -68,19 +118,70 @@ void ConvertApp::run() {
     reportProgress(0, "Starting conversion...");
 
     parseArgs();
+    if (threads_ > 0) {
+        omp_set_num_threads(threads_);
+    }
+    if (!shard_dir_.empty()) {
+        encodeShard();
+        return;
+    }
     findPlyFiles();
+    if ((lod_levels_ > 0 || !lod_budgets_.empty()) && lod_files_.size() > 1) {
+        log("Ignoring " + std::to_string(lod_files_.size() - 1) + " input LOD files; LODs are generated from LOD0\n");
+        lod_files_.resize(1);
+    }
 
     reportProgress(2, "Found " + std::to_string(lod_files_.size()) + " LOD files");
 
     // Create output directory
     fs::create_directories(output_dir_);
     log("Output: " + output_dir_.u8string() + "\n");
+    if (auto_cell_size_.enabled) {
+        tuneCellSize();
+    }
     log("Cell size: " + std::to_string(cell_size_x_) + " x " + std::to_string(cell_size_y_) + "\n");
 
-    // Step 1: Build spatial grid
+    const Region crop = gridCrop();
+    if (crop.enabled()) {
+        log("Crop: " + (crop_.polygon.empty() ? std::string("box")
+                                               : std::to_string(crop_.polygon.size()) + "-vertex polygon") + "\n");
+    }
+    const size_t total_splats = tiling_.enabled()
+        ? writeTiles(crop)
+        : writeOutput(prepareGrid(output_dir_, crop), output_dir_);
+
+    reportProgress(100, "Conversion complete!");
+
+    log("\nConversion complete!\n");
+    log("Total splats: " + std::to_string(total_splats) + "\n");
+    log("Output: " + output_dir_.u8string() + "\n");
+}
+
+// Phase 1 for the splats in `region`: bin them, then filter, re-grid and order cells
+SpatialGrid ConvertApp::prepareGrid(const fs::path& out_dir, const Region& region) {
     reportProgress(5, "Building spatial grid...");
     log("\nPhase 1: Building spatial grid...\n");
-    SpatialGrid grid = SpatialGrid::from_files(lod_files_, cell_size_x_, cell_size_y_);
+    SpatialGrid grid = buildGrid(out_dir, region);
+    if (grid.cells().empty()) {
+        return grid;
+    }
+    if (floaters_.enabled()) {
+        removeFloaters(grid);
+    }
+    if (grid.has_sh() && sh_mode_ != ShMode::Keep) {
+        applyShMode(grid);
+    }
+    if (lod_levels_ > 0 || !lod_budgets_.empty()) {
+        buildLodPyramid(grid, out_dir);
+    }
+    if (max_splats_ > 0 || target_size_ > 0) {
+        applyRateControl(grid);
+    }
+    if (splat_order_ != SplatOrder::Input) {
+        const char* names[] = {"input", "morton", "hilbert", "importance"};
+        log("Sorting splats within cells (" + std::string(names[static_cast<int>(splat_order_)]) + ")\n");
+        sort_cell_splats(grid, lod_files_, splat_order_);
+    }
 
     log("Global bbox: (" + std::to_string(grid.bbox().min.x) + ", " +
         std::to_string(grid.bbox().min.y) + ", " + std::to_string(grid.bbox().min.z) +
@@ -89,20 +190,191 @@ void ConvertApp::run() {
     log("Created " + std::to_string(grid.cells().size()) + " grid cells\n");
     log("SH: " + (grid.has_sh() ? "degree " + std::to_string(grid.sh_degree()) +
         " (" + std::to_string(grid.num_f_rest()) + " coefficients)" : std::string("none")) + "\n");
+    return grid;
+}
+
+size_t ConvertApp::writeOutput(const SpatialGrid& grid, const fs::path& out_dir) {
+    return layer_height_ > 0.0f ? writeLayers(grid, out_dir) : writeScene(grid, out_dir);
+}
 
+size_t ConvertApp::writeTiles(const Region& crop) {
+    SplatBuffer lod0;
+    if (!lod0.initialize(lod_files_[0], &transform_)) {
+        throw std::runtime_error("Failed to read " + lod_files_[0].u8string() + ": " + lod0.error());
+    }
+    BBox bbox = lod0.compute_bbox();
+    if (bbox.min.x > bbox.max.x) {
+        throw std::runtime_error("LOD0 has no splats with finite positions");
+    }
+    // Tiles cover only the cropped part of the scene
+    bbox.min = Vec3f(std::max(bbox.min.x, crop.min_x), std::max(bbox.min.y, crop.min_y),
+                     std::max(bbox.min.z, crop.min_z));
+    bbox.max = Vec3f(std::min(bbox.max.x, crop.max_x), std::min(bbox.max.y, crop.max_y),
+                     std::min(bbox.max.z, crop.max_z));
+    if (!(bbox.min.x <= bbox.max.x && bbox.min.y <= bbox.max.y && bbox.min.z <= bbox.max.z)) {
+        throw std::runtime_error("The crop region does not overlap the LOD0 bbox");
+    }
+
+    float tile_size = tiling_.tile_size;
+    if (tile_size <= 0.0f) {
+        // Largest square tile whose densest instance stays within the splat budget
+        AutoCellSize sizing;
+        sizing.enabled = true;
+        sizing.splats_per_cell = tiling_.max_splats;
+        sizing.percentile = 100.0f;
+        tile_size = tune_cell_size(lod_files_[0], sizing, transform_).cell_size;
+    }
+    const auto tiles_x = static_cast<int64_t>(std::max(1.0f, std::ceil((bbox.max.x - bbox.min.x) / tile_size)));
+    const auto tiles_y = static_cast<int64_t>(std::max(1.0f, std::ceil((bbox.max.y - bbox.min.y) / tile_size)));
+    if (tiles_x * tiles_y > MAX_TILES) {
+        throw std::runtime_error("Tile size " + std::to_string(tile_size) + " m gives " +
+                                 std::to_string(tiles_x * tiles_y) + " tiles; use a larger --tile-size");
+    }
+    log("\nTiling: " + std::to_string(tiles_x) + " x " + std::to_string(tiles_y) + " tiles of " +
+        std::to_string(tile_size) + " m\n");
+    if (tile_size / std::min(cell_size_x_, cell_size_y_) > 65535.0f) {
+        log("Warning: a tile spans more than 65535 cells; edge cells will absorb the rest\n");
+    }
+
+    SceneManifest manifest;
+    manifest.type = "tiles";
+    manifest.step = tile_size;
+    const std::vector<fs::path> inputs = lod_files_;
+    size_t total_splats = 0;
+    for (int64_t ty = 0; ty < tiles_y; ++ty) {
+        for (int64_t tx = 0; tx < tiles_x; ++tx) {
+            // Outer tiles extend to the crop (open-ended without one) so every
+            // LOD's splats land in exactly one tile
+            const float x0 = bbox.min.x + static_cast<float>(tx) * tile_size;
+            const float y0 = bbox.min.y + static_cast<float>(ty) * tile_size;
+            Region region = crop;
+            region.min_x = tx == 0 ? crop.min_x : x0;
+            region.min_y = ty == 0 ? crop.min_y : y0;
+            region.max_x = tx == tiles_x - 1 ? crop.max_x : x0 + tile_size;
+            region.max_y = ty == tiles_y - 1 ? crop.max_y : y0 + tile_size;
+
+            SceneEntry scene;
+            scene.path = "tile_" + std::to_string(tx) + "_" + std::to_string(ty);
+            log("\nTile " + std::to_string(tx) + "," + std::to_string(ty) + "\n");
+
+            lod_files_ = inputs;  // Drop LODs generated for the previous tile
+            SpatialGrid grid = prepareGrid(output_dir_ / scene.path, region);
+            if (grid.cells().empty()) {
+                log("  No splats, skipped\n");
+                continue;
+            }
+
+            scene.bounds.min = Vec3f(x0, y0, bbox.min.z);
+            scene.bounds.max = Vec3f(std::min(x0 + tile_size, bbox.max.x),
+                                     std::min(y0 + tile_size, bbox.max.y), bbox.max.z);
+            scene.bbox = grid.bbox();
+            scene.total_splats = writeOutput(grid, output_dir_ / scene.path);
+            manifest.bbox.expand(scene.bbox);
+            total_splats += scene.total_splats;
+            manifest.scenes.push_back(std::move(scene));
+        }
+    }
+
+    LccWriter(output_dir_).write_manifest(manifest);
+    log("\nWrote " + std::to_string(manifest.scenes.size()) + " tile scenes and scenes.json\n");
+    return total_splats;
+}
+
+size_t ConvertApp::writeLayers(const SpatialGrid& grid, const fs::path& out_dir) {
+    auto layers = grid.split_layers(lod_files_, layer_height_);
+    log("\nSplitting into " + std::to_string(layers.size()) + " layers of " +
+        std::to_string(layer_height_) + " m\n");
+
+    SceneManifest manifest;
+    manifest.type = "layers";
+    manifest.step = layer_height_;
+    size_t total_splats = 0;
+    for (auto& [k, layer] : layers) {
+        SceneEntry scene;
+        scene.path = "layer_" + std::to_string(k);
+        scene.bbox = layer.bbox();
+        scene.bounds = layer.bbox();
+        scene.bounds.min.z = grid.bbox().min.z + static_cast<float>(k) * layer_height_;
+        scene.bounds.max.z = scene.bounds.min.z + layer_height_;
+        log("\nLayer " + std::to_string(k) + " (z " + std::to_string(scene.bounds.min.z) + " - " +
+            std::to_string(scene.bounds.max.z) + "): " + std::to_string(layer.cells().size()) + " cells\n");
+
+        scene.total_splats = writeScene(layer, out_dir / scene.path);
+        manifest.bbox.expand(scene.bbox);
+        total_splats += scene.total_splats;
+        manifest.scenes.push_back(std::move(scene));
+    }
+
+    LccWriter(out_dir).write_manifest(manifest);
+    log("\nWrote " + std::to_string(manifest.scenes.size()) + " layer scenes and scenes.json\n");
+    return total_splats;
+}
+
+// Phases 2-5 for one scene: encode the grid's cells plus environment, collision
+// and poses, and write a complete LCC directory. Returns the splats written.
+size_t ConvertApp::writeScene(const SpatialGrid& grid, const fs::path& out_dir) {
     // Step 2: Encode all data
     reportProgress(15, "Encoding splats...");
     log("\nPhase 2: Encoding splats...\n");
+    const bool distributed = workers_ > 1;
+    if (distributed && incremental_) {
+        log("Note: --incremental is ignored with --workers\n");
+    }
+    const bool incremental = incremental_ && !distributed;
+
     GridEncoder encoder;
     encoder.set_progress_callback([this](int pct, const std::string& msg) {
         reportProgress(15 + pct * 75 / 100, msg);
     });
-    LccData data = encoder.encode(grid, lod_files_);
+    encoder.set_scatter(scatter_encode_);
+    encoder.set_prefetch_distance(prefetch_distance_);
+    encoder.set_stage_rows(stage_rows_);
+    encoder.set_cell_layout(cell_layout_);
+    encoder.set_lod_major(lod_major_);
+    encoder.set_transform(grid.transform());
+    if (scatter_encode_ && incremental) {
+        log("Note: --scatter-encode is ignored with --incremental (cells are hashed in gather order)\n");
+    }
 
-    // Step 3: Encode environment (if exists)
+    // Incremental mode: reuse cells whose input hash is unchanged since the last run
+    const fs::path manifest_path = out_dir / ".ply2lcc" / "cells.manifest";
+    const EncodedSource previous_output{out_dir / "data.bin", out_dir / "shcoef.bin"};
+    CellManifest previous_manifest;
+    if (incremental) {
+        encoder.set_incremental(true);
+        if (previous_manifest.load(manifest_path) &&
+            previous_manifest.matches_files(previous_output.data_path, previous_output.sh_path)) {
+            encoder.set_previous_output(&previous_manifest, previous_output);
+            log("Incremental: previous manifest has " + std::to_string(previous_manifest.size()) + " cells\n");
+        } else {
+            log("Incremental: no usable manifest, encoding all cells\n");
+        }
+    } else {
+        // A full run invalidates any manifest left by an earlier incremental run
+        std::error_code ec;
+        fs::remove(manifest_path, ec);
+    }
+
+    LccData data = distributed ? encodeDistributed(grid, out_dir) : encoder.encode(grid, lod_files_);
+
+    if (incremental) {
+        size_t reused = std::count_if(data.cells.begin(), data.cells.end(),
+                                      [](const EncodedCellData& c) { return c.source >= 0; });
+        log("Incremental: reused " + std::to_string(reused) + " of " +
+            std::to_string(data.cells.size()) + " cells\n");
+    }
+
+    // Step 3: Encode environment (the -e file plus LOD0 splats separated from the core)
+    std::vector<EnvironmentSource> env_sources;
     if (!env_file_.empty() && fs::exists(env_file_)) {
+        env_sources.push_back({env_file_, {}});
+    }
+    if (!grid.environment().rows.empty()) {
+        env_sources.push_back({lod_files_[0], grid.environment().rows});
+    }
+    if (!env_sources.empty()) {
         log("\nPhase 3: Encoding environment...\n");
-        data.environment = encoder.encode_environment(env_file_, grid.has_sh());
+        data.environment = encoder.encode_environment(env_sources, grid.has_sh());
         log("  Environment: " + std::to_string(data.environment.count) + " splats\n");
     }
 
@@ -112,8 +384,11 @@ void ConvertApp::run() {
         log("\nPhase 4: Encoding collision mesh...\n");
         CollisionEncoder collision_encoder;
         collision_encoder.set_log_callback([this](const std::string& msg) { log(msg); });
-        // Pass scene bbox so collision cells align with splat grid cells
-        data.collision = collision_encoder.encode(collision_file_, cell_size_x_, cell_size_y_, grid.bbox());
+        collision_encoder.set_transform(grid.transform());
+        // Pass the grid's bbox and cell size so collision cells align with splat
+        // grid cells
+        data.collision = collision_encoder.encode(collision_file_, grid.cell_size_x(), grid.cell_size_y(),
+                                                  grid.bbox());
         if (!data.collision.empty()) {
             log("  Collision: " + std::to_string(data.collision.total_triangles()) + " triangles, " +
                 std::to_string(data.collision.cells.size()) + " cells\n");
@@ -126,17 +401,526 @@ void ConvertApp::run() {
         log("\nIncluded poses from: " + poses_file_.u8string() + "\n");
     }
 
+    // The rotation is in the splats; the rest of --transform is left to the viewer
+    std::copy(transform_.translation, transform_.translation + 3, data.offset);
+    data.scale = transform_.scale;
+
     // Step 5: Write all output files
     reportProgress(90, "Writing output files...");
     log("\nPhase 5: Writing LCC data...\n");
-    LccWriter writer(output_dir_);
+    LccWriter writer(out_dir);
     writer.write(data);
+    if (distributed) {
+        // The shards were copied into data.bin/shcoef.bin
+        std::error_code ec;
+        fs::remove_all(out_dir / ".ply2lcc" / "shards", ec);
+    }
 
-    reportProgress(100, "Conversion complete!");
+    if (incremental) {
+        CellManifest manifest = CellManifest::from_data(data);
+        manifest.record_files(previous_output.data_path, previous_output.sh_path);
+        if (!manifest.save(manifest_path)) {
+            log("Warning: failed to write manifest: " + manifest_path.u8string() + "\n");
+        }
+    }
 
-    log("\nConversion complete!\n");
-    log("Total splats: " + std::to_string(data.total_splats) + "\n");
-    log("Output: " + output_dir_.u8string() + "\n");
+    return data.total_splats;
+}
+
+// Shard grids are only read back by workers of the same run
+static const std::string SHARD_KEY = "ply2lcc-shard";
+
+// Coordinator: split the cells into shards of consecutive cells with about equal
+// splat counts, have a worker process encode each one into its own directory
+// with the grid's global ranges, then return cells that reference the workers'
+// data.bin/shcoef.bin so LccWriter stitches them by copying byte ranges
+LccData ConvertApp::encodeDistributed(const SpatialGrid& grid, const fs::path& out_dir) {
+    size_t total = 0;
+    for (const auto& [id, cell] : grid.cells()) {
+        for (const auto& rows : cell.splat_indices) total += rows.size();
+    }
+    std::vector<std::vector<uint32_t>> shards(static_cast<size_t>(workers_));
+    size_t done = 0;
+    for (const auto& [id, cell] : grid.cells()) {
+        const size_t k = std::min(shards.size() - 1, done * shards.size() / std::max<size_t>(1, total));
+        shards[k].push_back(id);
+        for (const auto& rows : cell.splat_indices) done += rows.size();
+    }
+    shards.erase(std::remove_if(shards.begin(), shards.end(),
+                                [](const std::vector<uint32_t>& ids) { return ids.empty(); }),
+                 shards.end());
+
+    // Worker command: launcher prefix, this executable, then the encode options
+    std::vector<std::string> command;
+    std::istringstream launcher(worker_launcher_);
+    for (std::string token; launcher >> token;) command.push_back(token);
+    command.push_back(worker_executable_.has_parent_path() ? fs::absolute(worker_executable_).u8string()
+                                                           : worker_executable_.u8string());
+    if (scatter_encode_) command.push_back("--scatter-encode");
+    if (stage_rows_) command.push_back("--stage-rows");
+    command.push_back("--prefetch");
+    command.push_back(std::to_string(prefetch_distance_));
+    // Local workers share this machine's cores
+    const int threads = worker_launcher_.empty()
+        ? std::max(1, omp_get_max_threads() / static_cast<int>(shards.size()))
+        : threads_;
+    if (threads > 0) {
+        command.push_back("--threads");
+        command.push_back(std::to_string(threads));
+    }
+
+    const fs::path shards_dir = out_dir / ".ply2lcc" / "shards";
+    std::vector<fs::path> dirs;
+    std::vector<platform::Process> workers;
+    for (size_t k = 0; k < shards.size(); ++k) {
+        const fs::path dir = shards_dir / ("shard_" + std::to_string(k));
+        fs::create_directories(dir);
+        if (!grid.subset(shards[k]).save(dir / "grid.cache", SHARD_KEY)) {
+            throw std::runtime_error("Failed to write shard grid: " + (dir / "grid.cache").u8string());
+        }
+        auto job = platform::ofstream_open(dir / "shard.job", std::ios::out);
+        for (const auto& path : lod_files_) {
+            job << "lod " << fs::absolute(path).u8string() << "\n";
+        }
+        job.close();
+        if (!job) {
+            throw std::runtime_error("Failed to write shard job: " + (dir / "shard.job").u8string());
+        }
+
+        std::vector<std::string> args = command;
+        args.push_back("--encode-shard");
+        args.push_back(fs::absolute(dir).u8string());
+        workers.push_back(platform::spawn_process(args));
+        dirs.push_back(dir);
+        log("  Worker " + std::to_string(k) + ": " + std::to_string(shards[k].size()) + " cells\n");
+    }
+
+    std::string failed;
+    for (size_t k = 0; k < workers.size(); ++k) {
+        if (platform::wait_process(workers[k]) != 0) {
+            failed += (failed.empty() ? "" : ", ") + std::to_string(k);
+        }
+    }
+    if (!failed.empty()) {
+        throw std::runtime_error("Worker(s) " + failed + " failed; shards are in " + shards_dir.u8string());
+    }
+    reportProgress(85, "Stitching worker shards...");
+
+    LccData data;
+    data.num_lods = grid.num_lods();
+    data.bbox = grid.bbox();
+    data.ranges = grid.ranges();
+    data.has_sh = grid.has_sh();
+    data.sh_degree = grid.sh_degree();
+    data.cell_size_x = grid.cell_size_x();
+    data.cell_size_y = grid.cell_size_y();
+    data.cell_layout = cell_layout_;
+    data.lod_major = lod_major_;
+    data.splats_per_lod.resize(data.num_lods, 0);
+
+    for (size_t k = 0; k < dirs.size(); ++k) {
+        const EncodedSource source{dirs[k] / "data.bin", dirs[k] / "shcoef.bin"};
+        CellManifest manifest;
+        if (!manifest.load(dirs[k] / "cells.manifest") ||
+            !manifest.matches_files(source.data_path, source.sh_path)) {
+            throw std::runtime_error("Worker " + std::to_string(k) + " left no usable output in " +
+                                     dirs[k].u8string());
+        }
+        data.sources.push_back(source);
+
+        for (uint32_t id : shards[k]) {
+            const GridCell& cell = grid.cells().at(id);
+            for (size_t lod = 0; lod < data.num_lods; ++lod) {
+                const size_t count = cell.splat_indices[lod].size();
+                if (count == 0) continue;
+                const CellManifestEntry* entry = manifest.find(id, lod);
+                if (!entry || entry->count != count) {
+                    throw std::runtime_error("Worker " + std::to_string(k) + " output does not match its shard");
+                }
+                EncodedCellData enc(id, lod);
+                enc.count = count;
+                enc.source = static_cast<int>(k);
+                enc.source_data_offset = entry->data_offset;
+                enc.source_data_size = entry->data_size;
+                enc.source_sh_offset = entry->sh_offset;
+                enc.source_sh_size = entry->sh_size;
+                data.total_splats += count;
+                data.splats_per_lod[lod] += count;
+                data.cells.push_back(std::move(enc));
+            }
+        }
+    }
+    data.sort_cells();
+    return data;
+}
+
+// Worker: encode the shard grid written by encodeDistributed as a standalone LCC
+// in the shard directory, plus a cell manifest locating every cell in it
+void ConvertApp::encodeShard() {
+    auto job = platform::ifstream_open(shard_dir_ / "shard.job", std::ios::in);
+    if (!job) {
+        throw std::runtime_error("Failed to read shard job: " + (shard_dir_ / "shard.job").u8string());
+    }
+    std::vector<fs::path> lod_files;
+    for (std::string line; std::getline(job, line);) {
+        if (line.rfind("lod ", 0) == 0) lod_files.push_back(fs::u8path(line.substr(4)));
+    }
+
+    auto grid = SpatialGrid::load(shard_dir_ / "grid.cache", SHARD_KEY, lod_files.size());
+    if (!grid) {
+        throw std::runtime_error("Failed to load shard grid: " + (shard_dir_ / "grid.cache").u8string());
+    }
+
+    GridEncoder encoder;
+    encoder.set_scatter(scatter_encode_);
+    encoder.set_prefetch_distance(prefetch_distance_);
+    encoder.set_stage_rows(stage_rows_);
+    encoder.set_transform(grid->transform());
+    LccData data = encoder.encode(*grid, lod_files);
+
+    LccWriter writer(shard_dir_);
+    writer.write(data);
+
+    CellManifest manifest = CellManifest::from_data(data);
+    manifest.record_files(shard_dir_ / "data.bin", shard_dir_ / "shcoef.bin");
+    if (!manifest.save(shard_dir_ / "cells.manifest")) {
+        throw std::runtime_error("Failed to write manifest: " + (shard_dir_ / "cells.manifest").u8string());
+    }
+    log("Shard " + shard_dir_.filename().u8string() + ": " + std::to_string(data.total_splats) +
+        " splats in " + std::to_string(grid->cells().size()) + " cells\n");
+}
+
+// Generated levels go under the scene being written, so tiles never share them
+void ConvertApp::buildLodPyramid(SpatialGrid& grid, const fs::path& out_dir) {
+    size_t lod0_splats = 0;
+    for (const auto& [id, cell] : grid.cells()) {
+        lod0_splats += cell.splat_indices[0].size();
+    }
+
+    std::vector<size_t> budgets = lod_budgets_.empty()
+        ? LodBuilder::default_budgets(lod0_splats, lod_levels_)
+        : lod_budgets_;
+
+    log("Generating " + std::to_string(budgets.size()) + " LOD levels from LOD0...\n");
+    LodBuilder builder(budgets);
+    auto files = builder.build(grid, lod_files_[0], out_dir / ".ply2lcc");
+    lod_files_.insert(lod_files_.end(), files.begin(), files.end());
+
+    for (size_t lod = 1; lod < grid.num_lods(); ++lod) {
+        size_t count = 0;
+        for (const auto& [id, cell] : grid.cells()) {
+            count += cell.splat_indices[lod].size();
+        }
+        log("  LOD" + std::to_string(lod) + ": " + std::to_string(count) + " splats (budget " +
+            std::to_string(budgets[lod - 1]) + ")\n");
+    }
+}
+
+static std::string format_megabytes(uint64_t bytes) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.1f MB", static_cast<double>(bytes) / 1e6);
+    return buf;
+}
+
+// Byte count with an optional decimal K, M or G suffix (e.g. 200M = 200,000,000)
+static uint64_t parse_byte_size(const std::string& text) {
+    double value = 0.0;
+    char suffix[4] = {};
+    int fields = sscanf(text.c_str(), "%lf%3s", &value, suffix);
+    if (fields < 1 || !(value > 0.0)) {
+        throw std::runtime_error("Invalid size '" + text + "'. Use a byte count such as 200M or 1.5G");
+    }
+    std::string unit(suffix);
+    if (!unit.empty() && (unit.back() == 'B' || unit.back() == 'b')) unit.pop_back();
+    if (unit == "K" || unit == "k") {
+        value *= 1e3;
+    } else if (unit == "M" || unit == "m") {
+        value *= 1e6;
+    } else if (unit == "G" || unit == "g") {
+        value *= 1e9;
+    } else if (!unit.empty()) {
+        throw std::runtime_error("Invalid size suffix in '" + text + "'. Use K, M or G");
+    }
+    return static_cast<uint64_t>(value);
+}
+
+// --transform: 16 comma-separated numbers (row-major 4x4 matrix) or 7 as
+// tx,ty,tz,rx,ry,rz,s (translation, rotations in degrees about x then y then z, scale)
+static SplatTransform parse_transform(const std::string& text) {
+    std::vector<double> values;
+    std::istringstream in(text);
+    for (std::string field; std::getline(in, field, ',');) {
+        char* end = nullptr;
+        const double value = std::strtod(field.c_str(), &end);
+        const bool parsed = end != field.c_str();
+        while (*end == ' ' || *end == '\t') ++end;  // Trailing whitespace only
+        if (!parsed || *end != '\0' || !std::isfinite(value)) {
+            values.clear();  // Not a finite number: rejected below
+            break;
+        }
+        values.push_back(value);
+    }
+    double m[16];
+    if (values.size() == 16) {
+        std::copy(values.begin(), values.end(), m);
+    } else if (values.size() == 7) {
+        const double deg = 3.14159265358979323846 / 180.0;
+        const double cx = std::cos(values[3] * deg), sx = std::sin(values[3] * deg);
+        const double cy = std::cos(values[4] * deg), sy = std::sin(values[4] * deg);
+        const double cz = std::cos(values[5] * deg), sz = std::sin(values[5] * deg);
+        const double s = values[6];
+        // R = Rz * Ry * Rx
+        const double r[3][3] = {{cz * cy, cz * sy * sx - sz * cx, cz * sy * cx + sz * sx},
+                                {sz * cy, sz * sy * sx + cz * cx, sz * sy * cx - cz * sx},
+                                {-sy, cy * sx, cy * cx}};
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 3; ++j) m[i * 4 + j] = s * r[i][j];
+            m[i * 4 + 3] = values[static_cast<size_t>(i)];
+        }
+        m[12] = m[13] = m[14] = 0.0;
+        m[15] = 1.0;
+    } else {
+        throw std::runtime_error("Invalid transform '" + text +
+                                 "'. Use 16 numbers (row-major 4x4) or tx,ty,tz,rx,ry,rz,s");
+    }
+    return SplatTransform::from_matrix(m);
+}
+
+// --crop: 4 or 6 comma-separated numbers (xmin,ymin,xmax,ymax or
+// xmin,ymin,zmin,xmax,ymax,zmax), otherwise a text file of x/y polygon vertices,
+// one "x y" or "x,y" per line ('#' starts a comment). The box of a polygon is its bounds
+static Region parse_crop(const std::string& text) {
+    std::vector<float> values;
+    std::istringstream in(text);
+    for (std::string field; std::getline(in, field, ',');) {
+        char* end = nullptr;
+        const float value = std::strtof(field.c_str(), &end);
+        if (end == field.c_str() || *end != '\0') {
+            values.clear();
+            break;
+        }
+        values.push_back(value);
+    }
+
+    Region crop;
+    if (values.size() == 4 || values.size() == 6) {
+        const size_t half = values.size() / 2;
+        crop.min_x = values[0];
+        crop.min_y = values[1];
+        crop.max_x = values[half];
+        crop.max_y = values[half + 1];
+        if (half == 3) {
+            crop.min_z = values[2];
+            crop.max_z = values[5];
+        }
+        if (!(crop.min_x < crop.max_x && crop.min_y < crop.max_y && crop.min_z < crop.max_z)) {
+            throw std::runtime_error("Invalid crop box '" + text + "'. Each minimum must be below its maximum");
+        }
+        return crop;
+    }
+
+    auto file = platform::ifstream_open(fs::u8path(text), std::ios::in);
+    if (!file) {
+        throw std::runtime_error("Invalid crop '" + text +
+                                 "'. Use xmin,ymin,xmax,ymax, xmin,ymin,zmin,xmax,ymax,zmax or a polygon file");
+    }
+    for (std::string line; std::getline(file, line);) {
+        line = line.substr(0, line.find('#'));
+        std::replace(line.begin(), line.end(), ',', ' ');
+        std::istringstream fields(line);
+        std::array<float, 2> vertex;
+        if (fields >> vertex[0] >> vertex[1]) {
+            crop.polygon.push_back(vertex);
+        } else if (line.find_first_not_of(" \t\r") != std::string::npos) {
+            throw std::runtime_error("Invalid crop polygon line '" + line + "' in " + text);
+        }
+    }
+    if (crop.polygon.size() < 3) {
+        throw std::runtime_error("Crop polygon " + text + " needs at least 3 vertices");
+    }
+    crop.min_x = crop.max_x = crop.polygon[0][0];
+    crop.min_y = crop.max_y = crop.polygon[0][1];
+    for (const auto& v : crop.polygon) {
+        crop.min_x = std::min(crop.min_x, v[0]);
+        crop.max_x = std::max(crop.max_x, v[0]);
+        crop.min_y = std::min(crop.min_y, v[1]);
+        crop.max_y = std::max(crop.max_y, v[1]);
+    }
+    crop.max_x = std::nextafter(crop.max_x, std::numeric_limits<float>::infinity());  // Box is half-open
+    crop.max_y = std::nextafter(crop.max_y, std::numeric_limits<float>::infinity());
+    return crop;
+}
+
+// The crop is given where the output lands; splats are binned before the
+// translation and scale of --transform, so undo those on the crop instead
+Region ConvertApp::gridCrop() const {
+    Region grid_crop = crop_;
+    auto map = [this](float& value, int axis) {
+        value = static_cast<float>((static_cast<double>(value) - transform_.translation[axis]) / transform_.scale);
+    };
+    map(grid_crop.min_x, 0);
+    map(grid_crop.max_x, 0);
+    map(grid_crop.min_y, 1);
+    map(grid_crop.max_y, 1);
+    map(grid_crop.min_z, 2);
+    map(grid_crop.max_z, 2);
+    for (auto& v : grid_crop.polygon) {
+        map(v[0], 0);
+        map(v[1], 1);
+    }
+    return grid_crop;
+}
+
+void ConvertApp::applyShMode(SpatialGrid& grid) {
+    if (sh_mode_ == ShMode::Drop) {
+        log("SH: dropped, encoding Portable\n");
+        grid.drop_sh();
+        return;
+    }
+
+    const ShEnergy& energy = grid.sh_energy();
+    char buf[256];
+    snprintf(buf, sizeof(buf),
+             "SH energy relative to f_dc: degree 1 %.3f, degree 2 %.3f, degree 3 %.3f (total %.3f)\n"
+             "  Dropping SH changes colour by %.2f/255 RMS over view directions\n",
+             energy.band_ratio(1), energy.band_ratio(2), energy.band_ratio(3), energy.total_ratio(),
+             energy.view_dependent_rms() * 255.0);
+    log(buf);
+
+    const bool portable = energy.total_ratio() < sh_threshold_;
+    snprintf(buf, sizeof(buf), "%.3f", sh_threshold_);
+    if (sh_mode_ == ShMode::Auto) {
+        if (portable) {
+            log("  Below threshold " + std::string(buf) + ": encoding Portable (32 instead of 96 bytes per splat)\n");
+            grid.drop_sh();
+        } else {
+            log("  At or above threshold " + std::string(buf) + ": encoding Quality\n");
+        }
+    } else {
+        log(std::string("  Recommendation: ") + (portable ? "Portable" : "Quality") +
+            " (threshold " + buf + "; use --sh-mode auto to apply)\n");
+    }
+}
+
+void ConvertApp::applyRateControl(SpatialGrid& grid) {
+    const size_t bytes_per_splat = output_bytes_per_splat(grid.has_sh());
+    size_t budget = max_splats_ > 0 ? max_splats_ : SIZE_MAX;
+    if (target_size_ > 0) {
+        budget = std::min(budget, static_cast<size_t>(target_size_ / bytes_per_splat));
+    }
+
+    const size_t before = count_grid_splats(grid);
+    log("Rate control: " + std::to_string(before) + " splats (" +
+        format_megabytes(static_cast<uint64_t>(before) * bytes_per_splat) + "), budget " +
+        std::to_string(budget) + " splats\n");
+    if (before <= budget) return;
+
+    const size_t after = prune_to_budget(grid, lod_files_, budget);
+    log("  Kept the " + std::to_string(after) + " most important splats (" +
+        format_megabytes(static_cast<uint64_t>(after) * bytes_per_splat) + ")\n");
+}
+
+void ConvertApp::removeFloaters(SpatialGrid& grid) {
+    char sigma_str[16];
+    snprintf(sigma_str, sizeof(sigma_str), "%.1f", floaters_.sigma);
+    log("Removing floaters (k=" + std::to_string(floaters_.k) + ", sigma=" + sigma_str + ")...\n");
+
+    FloaterResult floaters = find_floaters(grid, lod_files_, floaters_);
+    size_t removed = 0;
+    for (size_t lod = 0; lod < floaters.removed.size(); ++lod) {
+        removed += floaters.removed[lod];
+        log("  LOD" + std::to_string(lod) + ": removed " + std::to_string(floaters.removed[lod]) +
+            " splats (mean neighbour distance > " + std::to_string(floaters.threshold[lod]) + " m)\n");
+    }
+    if (removed > 0) {
+        grid.remove_rows(lod_files_, floaters.drop);
+    }
+}
+
+void ConvertApp::logPruneStats(const SpatialGrid& grid) {
+    if (grid.non_finite_positions() > 0) {
+        log("Warning: " + std::to_string(grid.non_finite_positions()) +
+            (prune_.drop_non_finite ? " splats have NaN/Inf positions and are dropped\n"
+                                    : " splats have NaN/Inf positions; use --prune to drop them\n"));
+    }
+    if (!prune_.enabled()) return;
+
+    const auto& stats = grid.prune_stats();
+    for (size_t lod = 0; lod < stats.size(); ++lod) {
+        size_t kept = 0;
+        for (const auto& [id, cell] : grid.cells()) {
+            kept += cell.splat_indices[lod].size();
+        }
+        const PruneStats& pruned = stats[lod];
+        size_t total = kept + pruned.total();
+        double pct = total > 0 ? 100.0 * static_cast<double>(pruned.total()) / static_cast<double>(total) : 0.0;
+        char pct_str[16];
+        snprintf(pct_str, sizeof(pct_str), "%.1f", pct);
+        log("  LOD" + std::to_string(lod) + ": pruned " + std::to_string(pruned.total()) + " of " +
+            std::to_string(total) + " splats (" + pct_str + "%; non-finite " +
+            std::to_string(pruned.non_finite) + ", opacity " + std::to_string(pruned.opacity) +
+            ", scale " + std::to_string(pruned.scale) + ")\n");
+    }
+}
+
+void ConvertApp::logEnvironmentSplit(const SpatialGrid& grid) {
+    if (!env_separation_.enabled()) return;
+
+    const EnvironmentSplit& env = grid.environment();
+    char radius_str[32];
+    snprintf(radius_str, sizeof(radius_str), "%.1f", env.radius);
+    log("  Environment: " + std::to_string(env.rows.size()) + " LOD0 splats beyond " + radius_str +
+        " m of the core moved to the environment stream");
+    if (env.dropped > 0) {
+        log(", " + std::to_string(env.dropped) + " LOD1+ splats dropped");
+    }
+    log("\n");
+}
+
+void ConvertApp::tuneCellSize() {
+    CellSizePrediction prediction = tune_cell_size(lod_files_[0], auto_cell_size_, transform_);
+    cell_size_x_ = prediction.cell_size;
+    cell_size_y_ = prediction.cell_size;
+
+    char line[256];
+    snprintf(line, sizeof(line),
+             "Auto cell size: %.2f m for <= %zu LOD0 splats per cell at p%g\n"
+             "  Predicted: %zu cells, splats per cell median %zu, p%g %zu, max %zu\n",
+             prediction.cell_size, prediction.target, auto_cell_size_.percentile, prediction.cells,
+             prediction.median, auto_cell_size_.percentile, prediction.at_percentile, prediction.max);
+    log(line);
+}
+
+SpatialGrid ConvertApp::buildGrid(const fs::path& out_dir, const Region& region) {
+    if (!use_grid_cache_) {
+        SpatialGrid grid = SpatialGrid::from_files(lod_files_, cell_size_x_, cell_size_y_, prune_, env_separation_,
+                                                   robust_, region, transform_);
+        logPruneStats(grid);
+        logEnvironmentSplit(grid);
+        return grid;
+    }
+
+    fs::path cache_path = out_dir / ".ply2lcc" / "grid.cache";
+    std::string key = SpatialGrid::cache_key(lod_files_, cell_size_x_, cell_size_y_, prune_, env_separation_,
+                                             robust_, region, transform_);
+
+    if (auto cached = SpatialGrid::load(cache_path, key, lod_files_.size())) {
+        log("Loaded grid from cache: " + cache_path.u8string() + "\n");
+        logPruneStats(*cached);
+        logEnvironmentSplit(*cached);
+        return std::move(*cached);
+    }
+
+    SpatialGrid grid = SpatialGrid::from_files(lod_files_, cell_size_x_, cell_size_y_, prune_, env_separation_,
+                                               robust_, region, transform_);
+    logPruneStats(grid);
+    logEnvironmentSplit(grid);
+    if (grid.save(cache_path, key)) {
+        log("Saved grid cache: " + cache_path.u8string() + "\n");
+    } else {
+        log("Warning: failed to write grid cache: " + cache_path.u8string() + "\n");
+    }
+    return grid;
 }
 
 void ConvertApp::printUsage() {
@@ -149,10 +933,67 @@ void ConvertApp::printUsage() {
               << "  -m <path>          Include collision mesh from specified .ply or .obj file\n"
               << "  -p <path>          Include trajectory poses from specified .json file\n"
               << "  --single-lod       Use only LOD0 even if more LOD files exist\n"
-              << "  --cell-size X,Y    Grid cell size in meters (default: 30,30)\n";
+              << "  --cell-size X,Y    Grid cell size in meters (default: 30,30), or auto to derive it from\n"
+              << "                     the LOD0 density (see --cell-target)\n"
+              << "  --cell-target N    Auto cell size: LOD0 splats per cell at the percentile (default: 100000)\n"
+              << "  --cell-target-size S  Auto cell size: output bytes per cell instead, e.g. 8M\n"
+              << "  --cell-percentile P Percentile of non-empty cells held to the target (default: 90)\n"
+              << "  --grid-cache       Reuse the Phase 1 grid from <output>/.ply2lcc when inputs are unchanged\n"
+              << "  --incremental      Only re-encode cells whose input changed since the last --incremental run\n"
+              << "  --scatter-encode   Encode by streaming the input in file order (sequential reads)\n"
+              << "  --prefetch N       Prefetch distance in rows for gather encoding (default: 8, 0 = off)\n"
+              << "  --stage-rows       Copy each cell's rows into a contiguous staging block before encoding\n"
+              << "  --splat-order O    Order of splats within a cell: input, morton, hilbert, importance\n"
+              << "                     (default: input)\n"
+              << "  --cell-layout L    Order of cells in data.bin: column, zorder, hilbert (default: column)\n"
+              << "  --lod-levels N     Generate N coarser LODs from LOD0, each 1/4 the size of the previous\n"
+              << "  --lod-budget A,B.. Generate LODs with these splat budgets (one per level)\n"
+              << "  --lod-major        Group all cells of each LOD together in data.bin, coarsest LOD first\n"
+              << "  --prune            Drop invisible splats: NaN/Inf, opacity < 1/255, scale < 1 mm\n"
+              << "  --prune-opacity A  Drop splats with opacity (after sigmoid) below A (implies --prune)\n"
+              << "  --prune-scale S    Drop splats whose largest axis is below S meters (implies --prune)\n"
+              << "  --remove-floaters  Drop splats whose mean distance to their 16 nearest neighbours exceeds\n"
+              << "                     the LOD mean by more than 3 standard deviations\n"
+              << "  --floater-k N      Neighbours per splat for floater removal (implies --remove-floaters)\n"
+              << "  --floater-sigma S  Standard deviations for floater removal (implies --remove-floaters)\n"
+              << "  --auto-env         Move LOD0 splats far from the dense core (sky, distant background) to the\n"
+              << "                     environment stream so the grid only covers the core\n"
+              << "  --env-radius-factor F  Core radius as a multiple of the 90th-percentile distance from the\n"
+              << "                     median center (default: 3, implies --auto-env)\n"
+              << "  --transform T      Rotate, scale and translate the input: 16 numbers (row-major 4x4) or\n"
+              << "                     tx,ty,tz,rx,ry,rz,s (degrees about x, y, z). The rotation is applied to\n"
+              << "                     the splats; translation and scale go to meta.lcc offset and scale\n"
+              << "  --crop C           Convert only splats inside C, in output coordinates: a box\n"
+              << "                     xmin,ymin,xmax,ymax or xmin,ymin,zmin,xmax,ymax,zmax, or a file of\n"
+              << "                     x y polygon vertices (one per line)\n"
+              << "  --layer-height H   Split the scene into z layers H meters tall, each written as its own\n"
+              << "                     LCC scene under <output>/layer_<k>, listed in <output>/scenes.json\n"
+              << "  --workers N        Encode in N worker processes that each write a shard of the cells; the\n"
+              << "                     shards are stitched into one output\n"
+              << "  --worker-launcher C  Command prefix for each worker, e.g. \"srun -N1 -n1\" to run workers on\n"
+              << "                     other nodes (the output directory must be on shared storage)\n"
+              << "  --threads N        Limit the number of threads per process\n"
+              << "  --tile-size S      Split the scene into S x S meter tiles, each converted as an independent\n"
+              << "                     LCC scene under <output>/tile_<x>_<y>, listed in <output>/scenes.json\n"
+              << "  --tile-splats N    Like --tile-size, with the largest tile size whose densest tile holds\n"
+              << "                     at most N LOD0 splats\n"
+              << "  --robust-bbox P    Clip the bbox to the (100-P)..P percentile of positions per axis; outliers\n"
+              << "                     go to the edge cells (e.g. 99.99)\n"
+              << "  --robust-ranges P  Clip scale and SH quantisation ranges to the (100-P)..P percentile\n"
+              << "                     (e.g. 99.9); outliers saturate\n"
+              << "  --sh-mode M        SH handling: keep, analyze, auto, drop (default: keep). analyze reports\n"
+              << "                     the SH energy; auto encodes Portable when it is below the threshold\n"
+              << "  --sh-threshold T   SH energy relative to f_dc below which auto picks Portable (default: 0.1)\n"
+              << "  --max-splats N     Keep at most N splats over all LODs, dropping the least important\n"
+              << "                     evenly across cells\n"
+              << "  --target-size S    Like --max-splats, for an estimated data.bin + shcoef.bin size\n"
+              << "                     (bytes, or with K/M/G suffix, e.g. 200M)\n";
 }
 
 void ConvertApp::parseArgs() {
+    if (argc_ > 0) {
+        worker_executable_ = fs::u8path(argv_[0]);  // Workers rerun this program
+    }
     for (int i = 1; i < argc_; ++i) {
         std::string arg = argv_[i];
         if (arg == "-i" && i + 1 < argc_) {
@@ -170,9 +1011,179 @@ void ConvertApp::parseArgs() {
             include_poses_ = true;
         } else if (arg == "--single-lod") {
             single_lod_ = true;
+        } else if (arg == "--grid-cache") {
+            use_grid_cache_ = true;
+        } else if (arg == "--incremental") {
+            incremental_ = true;
+        } else if (arg == "--scatter-encode") {
+            scatter_encode_ = true;
+        } else if (arg == "--prefetch" && i + 1 < argc_) {
+            if (sscanf(argv_[++i], "%d", &prefetch_distance_) != 1 || prefetch_distance_ < 0) {
+                throw std::runtime_error("Invalid prefetch distance. Use a non-negative integer");
+            }
+        } else if (arg == "--stage-rows") {
+            stage_rows_ = true;
+        } else if (arg == "--splat-order" && i + 1 < argc_) {
+            std::string order = argv_[++i];
+            if (order == "input") {
+                splat_order_ = SplatOrder::Input;
+            } else if (order == "morton") {
+                splat_order_ = SplatOrder::Morton;
+            } else if (order == "hilbert") {
+                splat_order_ = SplatOrder::Hilbert;
+            } else if (order == "importance") {
+                splat_order_ = SplatOrder::Importance;
+            } else {
+                throw std::runtime_error("Invalid splat order. Use input, morton, hilbert or importance");
+            }
+        } else if (arg == "--lod-levels" && i + 1 < argc_) {
+            if (sscanf(argv_[++i], "%d", &lod_levels_) != 1 || lod_levels_ < 0) {
+                throw std::runtime_error("Invalid LOD level count. Use a non-negative integer");
+            }
+        } else if (arg == "--lod-budget" && i + 1 < argc_) {
+            lod_budgets_.clear();
+            std::stringstream ss(argv_[++i]);
+            std::string item;
+            while (std::getline(ss, item, ',')) {
+                unsigned long long budget = 0;
+                if (sscanf(item.c_str(), "%llu", &budget) != 1 || budget == 0) {
+                    throw std::runtime_error("Invalid LOD budget list. Use positive counts A,B,...");
+                }
+                lod_budgets_.push_back(static_cast<size_t>(budget));
+            }
+        } else if (arg == "--prune") {
+            prune_.drop_non_finite = true;
+            if (prune_.min_opacity == 0.0f) prune_.min_opacity = DEFAULT_PRUNE_OPACITY;
+            if (prune_.min_scale == 0.0f) prune_.min_scale = DEFAULT_PRUNE_SCALE;
+        } else if (arg == "--prune-opacity" && i + 1 < argc_) {
+            if (sscanf(argv_[++i], "%f", &prune_.min_opacity) != 1 ||
+                !(prune_.min_opacity >= 0.0f && prune_.min_opacity <= 1.0f)) {
+                throw std::runtime_error("Invalid prune opacity. Use a value in [0,1]");
+            }
+            prune_.drop_non_finite = true;
+        } else if (arg == "--prune-scale" && i + 1 < argc_) {
+            if (sscanf(argv_[++i], "%f", &prune_.min_scale) != 1 || !(prune_.min_scale >= 0.0f)) {
+                throw std::runtime_error("Invalid prune scale. Use a non-negative size in meters");
+            }
+            prune_.drop_non_finite = true;
+        } else if (arg == "--remove-floaters") {
+            if (floaters_.k == 0) floaters_.k = DEFAULT_FLOATER_K;
+        } else if (arg == "--floater-k" && i + 1 < argc_) {
+            if (sscanf(argv_[++i], "%d", &floaters_.k) != 1 || floaters_.k < 1) {
+                throw std::runtime_error("Invalid floater neighbour count. Use a positive integer");
+            }
+        } else if (arg == "--floater-sigma" && i + 1 < argc_) {
+            if (sscanf(argv_[++i], "%f", &floaters_.sigma) != 1 || !(floaters_.sigma > 0.0f)) {
+                throw std::runtime_error("Invalid floater sigma. Use a positive number");
+            }
+            if (floaters_.k == 0) floaters_.k = DEFAULT_FLOATER_K;
+        } else if (arg == "--auto-env") {
+            if (env_separation_.radius_factor == 0.0f) env_separation_.radius_factor = DEFAULT_ENV_RADIUS_FACTOR;
+        } else if (arg == "--env-radius-factor" && i + 1 < argc_) {
+            if (sscanf(argv_[++i], "%f", &env_separation_.radius_factor) != 1 ||
+                !(env_separation_.radius_factor > 0.0f)) {
+                throw std::runtime_error("Invalid environment radius factor. Use a positive number");
+            }
+        } else if (arg == "--cell-target" && i + 1 < argc_) {
+            unsigned long long splats = 0;
+            if (sscanf(argv_[++i], "%llu", &splats) != 1 || splats == 0) {
+                throw std::runtime_error("Invalid cell target. Use a positive splat count");
+            }
+            auto_cell_size_.splats_per_cell = static_cast<size_t>(splats);
+            auto_cell_size_.enabled = true;
+        } else if (arg == "--cell-target-size" && i + 1 < argc_) {
+            auto_cell_size_.bytes_per_cell = parse_byte_size(argv_[++i]);
+            auto_cell_size_.enabled = true;
+        } else if (arg == "--cell-percentile" && i + 1 < argc_) {
+            if (sscanf(argv_[++i], "%f", &auto_cell_size_.percentile) != 1 ||
+                !(auto_cell_size_.percentile > 0.0f && auto_cell_size_.percentile <= 100.0f)) {
+                throw std::runtime_error("Invalid cell percentile. Use a value in (0,100]");
+            }
+            auto_cell_size_.enabled = true;
+        } else if (arg == "--workers" && i + 1 < argc_) {
+            if (sscanf(argv_[++i], "%d", &workers_) != 1 || workers_ < 1) {
+                throw std::runtime_error("Invalid worker count. Use a positive integer");
+            }
+        } else if (arg == "--worker-launcher" && i + 1 < argc_) {
+            worker_launcher_ = argv_[++i];
+        } else if (arg == "--threads" && i + 1 < argc_) {
+            if (sscanf(argv_[++i], "%d", &threads_) != 1 || threads_ < 1) {
+                throw std::runtime_error("Invalid thread count. Use a positive integer");
+            }
+        } else if (arg == "--encode-shard" && i + 1 < argc_) {
+            shard_dir_ = fs::u8path(argv_[++i]);
+        } else if (arg == "--tile-size" && i + 1 < argc_) {
+            if (sscanf(argv_[++i], "%f", &tiling_.tile_size) != 1 || !(tiling_.tile_size > 0.0f)) {
+                throw std::runtime_error("Invalid tile size. Use a positive number of meters");
+            }
+        } else if (arg == "--tile-splats" && i + 1 < argc_) {
+            unsigned long long max_splats = 0;
+            if (sscanf(argv_[++i], "%llu", &max_splats) != 1 || max_splats == 0) {
+                throw std::runtime_error("Invalid tile splat budget. Use a positive splat count");
+            }
+            tiling_.max_splats = static_cast<size_t>(max_splats);
+        } else if (arg == "--transform" && i + 1 < argc_) {
+            transform_ = parse_transform(argv_[++i]);
+        } else if (arg == "--crop" && i + 1 < argc_) {
+            crop_ = parse_crop(argv_[++i]);
+        } else if (arg == "--layer-height" && i + 1 < argc_) {
+            if (sscanf(argv_[++i], "%f", &layer_height_) != 1 || !(layer_height_ > 0.0f)) {
+                throw std::runtime_error("Invalid layer height. Use a positive number of meters");
+            }
+        } else if (arg == "--robust-bbox" && i + 1 < argc_) {
+            if (sscanf(argv_[++i], "%f", &robust_.bbox_percentile) != 1 ||
+                !(robust_.bbox_percentile > 50.0f && robust_.bbox_percentile <= 100.0f)) {
+                throw std::runtime_error("Invalid bbox percentile. Use a value in (50,100], e.g. 99.99");
+            }
+        } else if (arg == "--robust-ranges" && i + 1 < argc_) {
+            if (sscanf(argv_[++i], "%f", &robust_.range_percentile) != 1 ||
+                !(robust_.range_percentile > 50.0f && robust_.range_percentile <= 100.0f)) {
+                throw std::runtime_error("Invalid range percentile. Use a value in (50,100], e.g. 99.9");
+            }
+        } else if (arg == "--sh-mode" && i + 1 < argc_) {
+            std::string mode = argv_[++i];
+            if (mode == "keep") {
+                sh_mode_ = ShMode::Keep;
+            } else if (mode == "analyze") {
+                sh_mode_ = ShMode::Analyze;
+            } else if (mode == "auto") {
+                sh_mode_ = ShMode::Auto;
+            } else if (mode == "drop") {
+                sh_mode_ = ShMode::Drop;
+            } else {
+                throw std::runtime_error("Invalid SH mode. Use keep, analyze, auto or drop");
+            }
+        } else if (arg == "--sh-threshold" && i + 1 < argc_) {
+            if (sscanf(argv_[++i], "%f", &sh_threshold_) != 1 || !(sh_threshold_ >= 0.0f)) {
+                throw std::runtime_error("Invalid SH threshold. Use a non-negative number");
+            }
+        } else if (arg == "--max-splats" && i + 1 < argc_) {
+            unsigned long long max_splats = 0;
+            if (sscanf(argv_[++i], "%llu", &max_splats) != 1 || max_splats == 0) {
+                throw std::runtime_error("Invalid splat budget. Use a positive integer");
+            }
+            max_splats_ = static_cast<size_t>(max_splats);
+        } else if (arg == "--target-size" && i + 1 < argc_) {
+            target_size_ = parse_byte_size(argv_[++i]);
+        } else if (arg == "--lod-major") {
+            lod_major_ = true;
+        } else if (arg == "--cell-layout" && i + 1 < argc_) {
+            std::string layout = argv_[++i];
+            if (layout == "column") {
+                cell_layout_ = CellLayout::Column;
+            } else if (layout == "zorder") {
+                cell_layout_ = CellLayout::ZOrder;
+            } else if (layout == "hilbert") {
+                cell_layout_ = CellLayout::Hilbert;
+            } else {
+                throw std::runtime_error("Invalid cell layout. Use column, zorder or hilbert");
+            }
         } else if (arg == "--cell-size" && i + 1 < argc_) {
-            if (sscanf(argv_[++i], "%f,%f", &cell_size_x_, &cell_size_y_) != 2) {
-                throw std::runtime_error("Invalid cell-size format. Use X,Y");
+            if (std::string(argv_[i + 1]) == "auto") {
+                auto_cell_size_.enabled = true;
+                ++i;
+            } else if (sscanf(argv_[++i], "%f,%f", &cell_size_x_, &cell_size_y_) != 2) {
+                throw std::runtime_error("Invalid cell-size format. Use X,Y or auto");
             }
         } else if (arg == "-h" || arg == "--help") {
             printUsage();
@@ -180,6 +1191,10 @@ void ConvertApp::parseArgs() {
         }
     }
 
+    if (!shard_dir_.empty()) {
+        return;  // Worker: everything else comes from the shard directory
+    }
+
     if (input_path_.empty() || output_dir_.empty()) {
         printUsage();
         throw std::runtime_error("Missing required arguments: -i and -o");
@@ -207,8 +1222,17 @@ void ConvertApp::findPlyFiles() {
     // LOD0 is the base file
     lod_files_.push_back(input_path_);
 
-    // Find numbered LOD files: base_1.ply, base_2.ply, ...
-    std::regex pattern(base_name_ + "_(\\d+)\\.ply");
+    // Sharded input (base_part0.ply, base_part1.ply, ...) is named by its first
+    // part; SplatBuffer maps the remaining parts of each LOD alongside it
+    std::string base_name = base_name_;
+    const std::string part0 = "_part0";
+    if (base_name.size() > part0.size() &&
+        base_name.compare(base_name.size() - part0.size(), part0.size(), part0) == 0) {
+        base_name.resize(base_name.size() - part0.size());
+    }
+
+    // Find numbered LOD files: base_1.ply, base_2.ply, ... (or base_1_part0.ply, ...)
+    std::regex pattern(base_name + "_(\\d+)(_part0)?\\.ply");
     std::vector<std::pair<int, fs::path>> numbered_files;
 
     for (const auto& entry : fs::directory_iterator(input_dir_)) {
@@ -226,6 +1250,7 @@ void ConvertApp::findPlyFiles() {
     // Add files until first gap (must be continuous from 1)
     int expected = 1;
     for (const auto& [num, path] : numbered_files) {
+        if (num == expected - 1) continue;  // Both base_N.ply and base_N_part0.ply: keep the first
         if (num != expected) break;
         lod_files_.push_back(path);
         expected++;
@@ -237,6 +1262,8 @@ void ConvertApp::findPlyFiles() {
 
     for (size_t i = 0; i < lod_files_.size(); ++i) {
         std::string filename = lod_files_[i].filename().u8string();
+        const size_t shards = SplatBuffer::shard_paths(lod_files_[i]).size();
+        if (shards > 1) filename += " (" + std::to_string(shards) + " shards)";
         if (single_lod_ && i > 0) {
             log("  LOD" + std::to_string(i) + ": " + filename + " (skipped: --single-lod)\n");
         } else {
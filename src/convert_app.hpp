@@ -2,6 +2,8 @@
 #define PLY2LCC_CONVERT_APP_HPP
 
 #include "types.hpp"
+#include "spatial_grid.hpp"
+#include "lcc_types.hpp"
 #include <string>
 #include <vector>
 #include <filesystem>
@@ -22,6 +24,22 @@ private:
     void parseArgs();
     void findPlyFiles();
     void printUsage();
+    void tuneCellSize();
+    Region gridCrop() const;
+    SpatialGrid buildGrid(const std::filesystem::path& out_dir, const Region& region);
+    SpatialGrid prepareGrid(const std::filesystem::path& out_dir, const Region& region);
+    void buildLodPyramid(SpatialGrid& grid, const std::filesystem::path& out_dir);
+    void logPruneStats(const SpatialGrid& grid);
+    void logEnvironmentSplit(const SpatialGrid& grid);
+    void removeFloaters(SpatialGrid& grid);
+    void applyRateControl(SpatialGrid& grid);
+    void applyShMode(SpatialGrid& grid);
+    size_t writeTiles(const Region& crop);
+    size_t writeOutput(const SpatialGrid& grid, const std::filesystem::path& out_dir);
+    size_t writeLayers(const SpatialGrid& grid, const std::filesystem::path& out_dir);
+    size_t writeScene(const SpatialGrid& grid, const std::filesystem::path& out_dir);
+    LccData encodeDistributed(const SpatialGrid& grid, const std::filesystem::path& out_dir);
+    void encodeShard();
 
     int argc_;
     char** argv_;
@@ -35,7 +53,35 @@ private:
     std::filesystem::path output_dir_;
     float cell_size_x_ = 30.0f;
     float cell_size_y_ = 30.0f;
+    AutoCellSize auto_cell_size_;
     bool single_lod_ = false;
+    bool use_grid_cache_ = false;
+    bool incremental_ = false;
+    bool scatter_encode_ = false;
+    int prefetch_distance_ = 8;
+    bool stage_rows_ = false;
+    SplatOrder splat_order_ = SplatOrder::Input;
+    CellLayout cell_layout_ = CellLayout::Column;
+    bool lod_major_ = false;
+    int lod_levels_ = 0;
+    std::vector<size_t> lod_budgets_;
+    SplatFilter prune_;
+    FloaterFilter floaters_;
+    EnvSeparation env_separation_;
+    RobustRanges robust_;
+    float layer_height_ = 0.0f;
+    Tiling tiling_;
+    SplatTransform transform_;
+    Region crop_;
+    int workers_ = 0;
+    std::string worker_launcher_;
+    std::filesystem::path worker_executable_;
+    int threads_ = 0;
+    std::filesystem::path shard_dir_;  // Set when running as a worker
+    size_t max_splats_ = 0;
+    uint64_t target_size_ = 0;
+    ShMode sh_mode_ = ShMode::Keep;
+    float sh_threshold_ = 0.1f;
 
     // Discovered files
     std::vector<std::filesystem::path> lod_files_;
@@ -0,0 +1,253 @@
+#include "floater_filter.hpp"
+#include "splat_buffer.hpp"
+#include <omp.h>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace ply2lcc {
+
+namespace {
+
+// Voxel rings searched around a splat. Neighbours not found within this many
+// rings are counted at the search radius, which is what flags isolated splats.
+constexpr int MAX_RINGS = 3;
+
+constexpr int VOXEL_BITS = 21;
+constexpr int64_t VOXEL_MAX = (int64_t(1) << VOXEL_BITS) - 1;
+constexpr float MIN_VOXEL = 1e-4f;
+
+uint64_t voxel_key(int64_t x, int64_t y, int64_t z) {
+    return static_cast<uint64_t>(x) | (static_cast<uint64_t>(y) << VOXEL_BITS) |
+           (static_cast<uint64_t>(z) << (2 * VOXEL_BITS));
+}
+
+// Uniform voxel hash over one cell's points (own splats first, then border
+// splats of the neighbouring cells)
+class VoxelHash {
+public:
+    VoxelHash(const std::vector<Vec3f>& points, float voxel) : m_inv(1.0f / voxel) {
+        m_origin = points[0];
+        for (const Vec3f& p : points) {
+            for (int a = 0; a < 3; ++a) m_origin[a] = std::min(m_origin[a], p[a]);
+        }
+
+        std::vector<std::pair<uint64_t, uint32_t>> keyed(points.size());
+        for (size_t i = 0; i < points.size(); ++i) {
+            int64_t v[3];
+            coords(points[i], v);
+            keyed[i] = {voxel_key(v[0], v[1], v[2]), static_cast<uint32_t>(i)};
+        }
+        std::sort(keyed.begin(), keyed.end());
+
+        m_points.resize(keyed.size());
+        m_ids.resize(keyed.size());
+        m_voxels.reserve(keyed.size() / 4 + 1);
+        for (size_t i = 0; i < keyed.size(); ++i) {
+            m_points[i] = points[keyed[i].second];
+            m_ids[i] = keyed[i].second;
+            auto [it, inserted] = m_voxels.emplace(keyed[i].first, std::make_pair(uint32_t(i), uint32_t(i + 1)));
+            if (!inserted) it->second.second = static_cast<uint32_t>(i + 1);
+        }
+    }
+
+    void coords(const Vec3f& p, int64_t v[3]) const {
+        for (int a = 0; a < 3; ++a) {
+            auto c = static_cast<int64_t>((p[a] - m_origin[a]) * m_inv);
+            v[a] = std::max<int64_t>(0, std::min(c, VOXEL_MAX));
+        }
+    }
+
+    // Point ids in voxel order
+    const std::vector<uint32_t>& ids() const { return m_ids; }
+
+    // Visit every point in voxel (x, y, z): fn(position, point id)
+    template <typename Fn>
+    void visit(int64_t x, int64_t y, int64_t z, Fn&& fn) const {
+        if (x < 0 || y < 0 || z < 0 || x > VOXEL_MAX || y > VOXEL_MAX || z > VOXEL_MAX) return;
+        auto it = m_voxels.find(voxel_key(x, y, z));
+        if (it == m_voxels.end()) return;
+        for (uint32_t i = it->second.first; i < it->second.second; ++i) {
+            fn(m_points[i], m_ids[i]);
+        }
+    }
+
+private:
+    Vec3f m_origin;
+    float m_inv;
+    std::vector<Vec3f> m_points;
+    std::vector<uint32_t> m_ids;
+    std::unordered_map<uint64_t, std::pair<uint32_t, uint32_t>> m_voxels;
+};
+
+// Mean distance from point `self` to its k nearest neighbours (searched up to MAX_RINGS voxels)
+float mean_knn_distance(const VoxelHash& hash, const Vec3f& p, uint32_t self, int k, float voxel,
+                        std::vector<float>& heap) {
+    heap.clear();
+    int64_t v[3];
+    hash.coords(p, v);
+
+    auto consider = [&](const Vec3f& q, uint32_t id) {
+        if (id == self) return;
+        float dx = q.x - p.x, dy = q.y - p.y, dz = q.z - p.z;
+        float d2 = dx * dx + dy * dy + dz * dz;
+        if (heap.size() < static_cast<size_t>(k)) {
+            heap.push_back(d2);
+            std::push_heap(heap.begin(), heap.end());
+        } else if (d2 < heap.front()) {
+            std::pop_heap(heap.begin(), heap.end());
+            heap.back() = d2;
+            std::push_heap(heap.begin(), heap.end());
+        }
+    };
+
+    for (int r = 0; r <= MAX_RINGS; ++r) {
+        // Voxels at Chebyshev distance exactly r
+        for (int dz = -r; dz <= r; ++dz) {
+            for (int dy = -r; dy <= r; ++dy) {
+                bool inner = std::abs(dz) < r && std::abs(dy) < r;
+                for (int dx = -r; dx <= r; dx += (inner && r > 0) ? 2 * r : 1) {
+                    hash.visit(v[0] + dx, v[1] + dy, v[2] + dz, consider);
+                }
+            }
+        }
+        // Anything in ring r + 1 is at least r voxels away
+        if (heap.size() == static_cast<size_t>(k) && heap.front() <= (r * voxel) * (r * voxel)) break;
+    }
+
+    double sum = 0.0;
+    for (float d2 : heap) sum += std::sqrt(d2);
+    sum += static_cast<double>(static_cast<size_t>(k) - heap.size()) * MAX_RINGS * voxel;
+    return static_cast<float>(sum / k);
+}
+
+} // namespace
+
+FloaterResult find_floaters(const SpatialGrid& grid,
+                            const std::vector<std::filesystem::path>& lod_files,
+                            const FloaterFilter& filter) {
+    FloaterResult result;
+    result.drop.resize(grid.num_lods());
+    result.removed.resize(grid.num_lods(), 0);
+    result.threshold.resize(grid.num_lods(), 0.0f);
+    if (!filter.enabled()) return result;
+
+    const float csx = grid.cell_size_x();
+    const float csy = grid.cell_size_y();
+    const Vec3f origin = grid.bbox().min;
+    const int k = filter.k;
+
+    std::vector<std::pair<uint32_t, const GridCell*>> cells;
+    cells.reserve(grid.cells().size());
+    for (const auto& [id, cell] : grid.cells()) {
+        cells.emplace_back(id, &cell);
+    }
+    const auto num_cells = static_cast<ptrdiff_t>(cells.size());
+
+    for (size_t lod = 0; lod < grid.num_lods(); ++lod) {
+        SplatBuffer splats;
+        if (!splats.initialize(lod_files[lod], &grid.transform())) {
+            throw std::runtime_error("Failed to read " + lod_files[lod].u8string() + ": " + splats.error());
+        }
+
+        // distances[c][i] = mean kNN distance of the i-th splat of cell c
+        std::vector<std::vector<float>> distances(cells.size());
+
+        #pragma omp parallel
+        {
+            std::vector<Vec3f> points;
+            std::vector<float> heap;
+            heap.reserve(static_cast<size_t>(k));
+
+            #pragma omp for schedule(dynamic)
+            for (ptrdiff_t c = 0; c < num_cells; ++c) {
+                const uint32_t cell_id = cells[static_cast<size_t>(c)].first;
+                const auto& indices = cells[static_cast<size_t>(c)].second->splat_indices[lod];
+                if (indices.empty()) continue;
+
+                points.clear();
+                float zmin = std::numeric_limits<float>::max();
+                float zmax = std::numeric_limits<float>::lowest();
+                for (size_t row : indices) {
+                    const Vec3f& p = splats[row].pos();
+                    points.push_back(p);
+                    zmin = std::min(zmin, p.z);
+                    zmax = std::max(zmax, p.z);
+                }
+                const size_t own = points.size();
+
+                // Voxel holding ~k splats, whether the cell's splats lie on a surface
+                // over its footprint or fill its volume
+                const float per_splat = csx * csy * static_cast<float>(k) / static_cast<float>(own);
+                float voxel = std::max(std::sqrt(per_splat), std::cbrt(per_splat * (zmax - zmin)));
+                voxel = std::clamp(voxel, MIN_VOXEL, std::max({csx, csy, zmax - zmin, MIN_VOXEL}));
+                const float margin = MAX_RINGS * voxel;
+
+                // Border splats of the 8 neighbouring cells
+                const int cx = static_cast<int>(cell_id & 0xFFFF);
+                const int cy = static_cast<int>(cell_id >> 16);
+                const float x0 = origin.x + static_cast<float>(cx) * csx - margin;
+                const float x1 = origin.x + static_cast<float>(cx + 1) * csx + margin;
+                const float y0 = origin.y + static_cast<float>(cy) * csy - margin;
+                const float y1 = origin.y + static_cast<float>(cy + 1) * csy + margin;
+                for (int dy = -1; dy <= 1; ++dy) {
+                    for (int dx = -1; dx <= 1; ++dx) {
+                        int nx = cx + dx, ny = cy + dy;
+                        if ((dx == 0 && dy == 0) || nx < 0 || ny < 0 || nx > 65535 || ny > 65535) continue;
+                        auto it = grid.cells().find((static_cast<uint32_t>(ny) << 16) | static_cast<uint32_t>(nx));
+                        if (it == grid.cells().end()) continue;
+                        for (size_t row : it->second.splat_indices[lod]) {
+                            const Vec3f& p = splats[row].pos();
+                            if (p.x >= x0 && p.x <= x1 && p.y >= y0 && p.y <= y1) points.push_back(p);
+                        }
+                    }
+                }
+
+                VoxelHash hash(points, voxel);
+                auto& cell_distances = distances[static_cast<size_t>(c)];
+                cell_distances.resize(own);
+                // Query in voxel order so consecutive searches touch the same voxels
+                for (uint32_t id : hash.ids()) {
+                    if (id >= own) continue;
+                    cell_distances[id] = mean_knn_distance(hash, points[id], id, k, voxel, heap);
+                }
+            }
+        }
+
+        // Threshold from the distribution over the whole LOD
+        double sum = 0.0, sum_sq = 0.0;
+        size_t count = 0;
+        #pragma omp parallel for schedule(static) reduction(+:sum, sum_sq, count)
+        for (ptrdiff_t c = 0; c < num_cells; ++c) {
+            for (float d : distances[static_cast<size_t>(c)]) {
+                sum += d;
+                sum_sq += static_cast<double>(d) * d;
+                count++;
+            }
+        }
+        if (count == 0) continue;
+
+        const double mean = sum / static_cast<double>(count);
+        const double stddev = std::sqrt(std::max(0.0, sum_sq / static_cast<double>(count) - mean * mean));
+        const auto threshold = static_cast<float>(mean + filter.sigma * stddev);
+        result.threshold[lod] = threshold;
+
+        auto& drop = result.drop[lod];
+        drop.assign(splats.size(), 0);
+        for (size_t c = 0; c < cells.size(); ++c) {
+            const auto& indices = cells[c].second->splat_indices[lod];
+            const auto& cell_distances = distances[c];
+            for (size_t i = 0; i < cell_distances.size(); ++i) {
+                if (cell_distances[i] > threshold) {
+                    drop[indices[i]] = 1;
+                    result.removed[lod]++;
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+} // namespace ply2lcc
@@ -0,0 +1,29 @@
+#ifndef PLY2LCC_FLOATER_FILTER_HPP
+#define PLY2LCC_FLOATER_FILTER_HPP
+
+#include "types.hpp"
+#include "spatial_grid.hpp"
+#include <cstdint>
+#include <vector>
+#include <filesystem>
+
+namespace ply2lcc {
+
+struct FloaterResult {
+    std::vector<std::vector<uint8_t>> drop;  // per LOD, per input row: 1 = floater
+    std::vector<size_t> removed;             // per LOD
+    std::vector<float> threshold;            // per LOD: mean kNN distance cut-off (meters)
+};
+
+// Find floaters in every LOD of the grid. Each grid cell is processed
+// independently (in parallel): its splats, plus those of the 8 neighbouring
+// cells near its border, are hashed into a voxel grid sized from the cell's
+// density and searched ring by ring for the k nearest neighbours.
+// Apply the result with SpatialGrid::remove_rows().
+FloaterResult find_floaters(const SpatialGrid& grid,
+                            const std::vector<std::filesystem::path>& lod_files,
+                            const FloaterFilter& filter);
+
+} // namespace ply2lcc
+
+#endif // PLY2LCC_FLOATER_FILTER_HPP
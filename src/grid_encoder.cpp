@@ -1,10 +1,14 @@
 #include "grid_encoder.hpp"
 #include "splat_buffer.hpp"
 #include "compression.hpp"
+#include "hash.hpp"
+#include "splat_order.hpp"
+#include "platform.hpp"
 #include <omp.h>
 #include <algorithm>
 #include <cmath>
 #include <cstring>
+#include <new>
 #include <stdexcept>
 
 namespace ply2lcc {
@@ -15,6 +19,82 @@ void GridEncoder::report_progress(int percent, const std::string& msg) {
     }
 }
 
+// Bump when the encoded byte format changes, so stale manifests never match
+static constexpr uint32_t ENCODER_FORMAT_VERSION = 1;
+
+// Everything besides the input rows that affects a cell's encoded bytes
+static uint64_t encode_context_seed(const LccData& result, const PropTable& table) {
+    XXH64 h;
+    h.update_pod(ENCODER_FORMAT_VERSION);
+    h.update_pod(result.ranges);
+    h.update_pod(result.has_sh);
+    h.update_pod(table.pos);
+    h.update_pod(table.f_dc);
+    h.update_pod(table.opacity);
+    h.update_pod(table.scale);
+    h.update_pod(table.rot);
+    h.update_pod(table.f_rest);
+    h.update_pod(table.row_stride);
+    h.update_pod(table.num_f_rest);
+    if (table.transform) {
+        h.update_pod(table.transform->rotation);  // Same rows encode differently when rotated
+    }
+    return h.digest();
+}
+
+// Visit a cell's rows in index order, prefetching the row `distance` entries ahead.
+// Rows span several cache lines, so every line of the upcoming row is requested.
+template <typename Fn>
+static void gather_rows(const SplatBuffer& splats, const std::vector<size_t>& indices,
+                        int distance, Fn&& fn) {
+    const size_t stride = splats.table().row_stride;
+    const size_t n = indices.size();
+    const size_t ahead = distance > 0 ? static_cast<size_t>(distance) : 0;
+
+    for (size_t k = 0; k < n; ++k) {
+        if (ahead > 0 && k + ahead < n) {
+            const uint8_t* next = splats.row(indices[k + ahead]);
+            for (size_t line = 0; line < stride; line += 64) {
+                platform::prefetch(next + line);
+            }
+        }
+        fn(k, splats.row(indices[k]));
+    }
+}
+
+namespace {
+
+// Thread-local block that a cell's rows are copied into before encoding
+class StagingBuffer {
+public:
+    StagingBuffer() = default;
+    ~StagingBuffer() { platform::free_large(m_data, m_capacity); }
+
+    StagingBuffer(const StagingBuffer&) = delete;
+    StagingBuffer& operator=(const StagingBuffer&) = delete;
+
+    uint8_t* reserve(size_t bytes) {
+        if (bytes > m_capacity) {
+            platform::free_large(m_data, m_capacity);
+            // Round up to 2 MB so the block can be backed by huge pages
+            constexpr size_t HUGE_PAGE = size_t(2) << 20;
+            m_capacity = (bytes + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+            m_data = static_cast<uint8_t*>(platform::alloc_large(m_capacity));
+            if (!m_data) {
+                m_capacity = 0;
+                throw std::bad_alloc();
+            }
+        }
+        return m_data;
+    }
+
+private:
+    uint8_t* m_data = nullptr;
+    size_t m_capacity = 0;
+};
+
+} // namespace
+
 LccData GridEncoder::encode(const SpatialGrid& grid,
                              const std::vector<std::filesystem::path>& lod_files) {
     LccData result;
@@ -25,6 +105,8 @@ LccData GridEncoder::encode(const SpatialGrid& grid,
     result.sh_degree = grid.sh_degree();
     result.cell_size_x = grid.cell_size_x();
     result.cell_size_y = grid.cell_size_y();
+    result.cell_layout = cell_layout_;
+    result.lod_major = lod_major_;
     result.splats_per_lod.resize(result.num_lods, 0);
 
     const auto& cells_map = grid.cells();
@@ -44,14 +126,30 @@ LccData GridEncoder::encode(const SpatialGrid& grid,
     int n_threads = omp_get_max_threads();
     std::vector<std::vector<EncodedCellData>> thread_cells(n_threads);
 
+    std::vector<StagingBuffer> staging(stage_rows_ ? n_threads : 0);
+
+    const bool reuse = incremental_ && previous_manifest_ != nullptr;
+    if (reuse) {
+        result.sources.push_back(previous_files_);
+    }
+
     for (size_t lod = 0; lod < result.num_lods; ++lod) {
         // Open SplatBuffer for this LOD
         SplatBuffer splats;
-        if (!splats.initialize(lod_files[lod])) {
+        if (!splats.initialize(lod_files[lod], &transform_)) {
             throw std::runtime_error("Failed to read " + lod_files[lod].u8string() + ": " + splats.error());
         }
 
-        result.splats_per_lod[lod] = splats.size();
+        const uint64_t context_seed = incremental_ ? encode_context_seed(result, splats.table()) : 0;
+        const size_t row_stride = splats.table().row_stride;
+
+        if (scatter_ && !incremental_) {
+            encode_lod_scatter(splats, lod, cells_vec, result, thread_cells[0]);
+            processed += cells_vec.size();
+            int percent = static_cast<int>(processed * 75 / std::max(size_t(1), total_work));
+            report_progress(15 + percent, "Encoded LOD" + std::to_string(lod) + " in file order");
+            continue;
+        }
 
         size_t report_interval = std::max(size_t(1), total_work / 100);
         const auto cells_count = static_cast<ptrdiff_t>(cells_vec.size());
@@ -71,17 +169,68 @@ LccData GridEncoder::encode(const SpatialGrid& grid,
                     continue;
                 }
 
+                const auto& indices = cell->splat_indices[lod];
                 EncodedCellData enc(cell_idx, lod);
-                enc.data.reserve(cell->splat_indices[lod].size() * 32);
-                if (result.has_sh) {
-                    enc.shcoef.reserve(cell->splat_indices[lod].size() * 64);
+                enc.count = indices.size();
+
+                // Stage mode: copy the cell's rows into a contiguous block first, so
+                // hashing and encoding read sequential memory
+                const uint8_t* staged = nullptr;
+                if (stage_rows_) {
+                    uint8_t* block = staging[tid].reserve(enc.count * row_stride);
+                    gather_rows(splats, indices, prefetch_distance_, [&](size_t k, const uint8_t* row) {
+                        std::memcpy(block + k * row_stride, row, row_stride);
+                    });
+                    staged = block;
+                }
+
+                const CellManifestEntry* prev = nullptr;
+                if (incremental_) {
+                    XXH64 h(context_seed);
+                    if (staged) {
+                        h.update(staged, enc.count * row_stride);
+                    } else {
+                        gather_rows(splats, indices, prefetch_distance_, [&](size_t, const uint8_t* row) {
+                            h.update(row, row_stride);
+                        });
+                    }
+                    enc.hash = h.digest();
+
+                    if (reuse) {
+                        prev = previous_manifest_->find(cell_idx, lod);
+                        if (prev && (prev->hash != enc.hash || prev->count != enc.count)) {
+                            prev = nullptr;
+                        }
+                    }
                 }
 
-                for (size_t idx : cell->splat_indices[lod]) {
-                    SplatView sv = splats[idx];
-                    encode_splat_view(sv, enc.data, enc.shcoef, result.ranges, result.has_sh);
+                if (prev) {
+                    // Unchanged since the previous run: copy bytes from the old output
+                    enc.source = 0;
+                    enc.source_data_offset = prev->data_offset;
+                    enc.source_data_size = prev->data_size;
+                    enc.source_sh_offset = prev->sh_offset;
+                    enc.source_sh_size = prev->sh_size;
+                } else {
+                    enc.data.resize(enc.count * 32);
+                    if (result.has_sh) {
+                        enc.shcoef.resize(enc.count * 64);
+                    }
+
+                    auto encode_row = [&](size_t k, const uint8_t* row) {
+                        uint8_t* sh_out = result.has_sh ? enc.shcoef.data() + k * 64 : nullptr;
+                        encode_splat_view(SplatView(row, splats.table()), enc.data.data() + k * 32,
+                                          sh_out, result.ranges, result.has_sh);
+                    };
+
+                    if (staged) {
+                        for (size_t k = 0; k < enc.count; ++k) {
+                            encode_row(k, staged + k * row_stride);
+                        }
+                    } else {
+                        gather_rows(splats, indices, prefetch_distance_, encode_row);
+                    }
                 }
-                enc.count = cell->splat_indices[lod].size();
 
                 local_cells.push_back(std::move(enc));
 
@@ -106,6 +255,7 @@ LccData GridEncoder::encode(const SpatialGrid& grid,
     for (auto& tc : thread_cells) {
         for (auto& cell : tc) {
             result.total_splats += cell.count;
+            result.splats_per_lod[cell.lod] += cell.count;  // What was encoded, not the input rows
             result.cells.push_back(std::move(cell));
         }
     }
@@ -116,22 +266,104 @@ LccData GridEncoder::encode(const SpatialGrid& grid,
     return result;
 }
 
+void GridEncoder::encode_lod_scatter(const SplatBuffer& splats, size_t lod,
+                                     const std::vector<std::pair<uint32_t, const GridCell*>>& cells,
+                                     const LccData& result, std::vector<EncodedCellData>& out) {
+    // Preallocate every non-empty cell at its final size
+    std::vector<EncodedCellData> encoded;
+    std::vector<const GridCell*> sources;
+    for (const auto& [cell_idx, cell] : cells) {
+        size_t count = cell->splat_indices[lod].size();
+        if (count == 0) continue;
+
+        EncodedCellData enc(cell_idx, lod);
+        enc.count = count;
+        enc.data.resize(count * 32);
+        if (result.has_sh) {
+            enc.shcoef.resize(count * 64);
+        }
+        encoded.push_back(std::move(enc));
+        sources.push_back(cell);
+    }
+
+    // Output slot of each cell's first splat: exclusive prefix sum of the cell counts
+    std::vector<size_t> base(encoded.size() + 1, 0);
+    for (size_t c = 0; c < encoded.size(); ++c) {
+        base[c + 1] = base[c] + encoded[c].count;
+    }
+    const size_t total = base.back();
+    if (total == 0) return;
+
+    // Pair every kept row with its slot. Cells are laid out back to back, so this
+    // writes both arrays sequentially; sorting the pairs by row then gives each
+    // row's destination in file order. Rows in no cell are simply absent.
+    std::vector<uint64_t> rows(total);
+    std::vector<size_t> slots(total);
+    const auto encoded_count = static_cast<ptrdiff_t>(encoded.size());
+
+    #pragma omp parallel for schedule(dynamic)
+    for (ptrdiff_t c = 0; c < encoded_count; ++c) {
+        const auto& indices = sources[static_cast<size_t>(c)]->splat_indices[lod];
+        const size_t first = base[static_cast<size_t>(c)];
+        for (size_t k = 0; k < indices.size(); ++k) {
+            rows[first + k] = indices[k];
+            slots[first + k] = first + k;
+        }
+    }
+    radix_sort_by_key(rows, slots, true);
+
+    // Stream the input strictly in file order; each thread gets a contiguous range
+    const auto row_count = static_cast<ptrdiff_t>(total);
+
+    #pragma omp parallel for schedule(static)
+    for (ptrdiff_t j = 0; j < row_count; ++j) {
+        const size_t slot = slots[static_cast<size_t>(j)];
+        const size_t c = static_cast<size_t>(std::upper_bound(base.begin(), base.end(), slot) - base.begin()) - 1;
+        EncodedCellData& enc = encoded[c];
+        const size_t k = slot - base[c];
+        uint8_t* sh_out = result.has_sh ? enc.shcoef.data() + k * 64 : nullptr;
+        encode_splat_view(splats[static_cast<size_t>(rows[static_cast<size_t>(j)])], enc.data.data() + k * 32,
+                          sh_out, result.ranges, result.has_sh);
+    }
+
+    for (auto& enc : encoded) {
+        out.push_back(std::move(enc));
+    }
+}
+
 EncodedEnvironment GridEncoder::encode_environment(const std::filesystem::path& env_path, bool has_sh) {
+    return encode_environment(std::vector<EnvironmentSource>{{env_path, {}}}, has_sh);
+}
+
+EncodedEnvironment GridEncoder::encode_environment(const std::vector<EnvironmentSource>& sources, bool has_sh) {
     EncodedEnvironment result;
 
-    SplatBuffer buffer;
-    if (!buffer.initialize(env_path)) {
-        return result;  // Empty result on failure
+    std::vector<SplatBuffer> buffers;
+    std::vector<const EnvironmentSource*> used;
+    for (const auto& source : sources) {
+        SplatBuffer buffer;
+        if (!buffer.initialize(source.path, &transform_)) {
+            continue;  // Skipped on failure
+        }
+        result.count += source.rows.empty() ? buffer.size() : source.rows.size();
+        buffers.push_back(std::move(buffer));
+        used.push_back(&source);
     }
 
-    result.count = buffer.size();
+    // Visit the selected rows of every source in order
+    auto for_each_splat = [&](auto&& fn) {
+        for (size_t s = 0; s < buffers.size(); ++s) {
+            const SplatBuffer& buffer = buffers[s];
+            const auto& rows = used[s]->rows;
+            const size_t n = rows.empty() ? buffer.size() : rows.size();
+            for (size_t i = 0; i < n; ++i) {
+                fn(buffer[rows.empty() ? i : rows[i]]);
+            }
+        }
+    };
 
     // Compute bounds from splats
-    int num_f_rest = buffer.num_f_rest();
-    int bands_per_channel = (num_f_rest > 0) ? num_f_rest / 3 : 0;
-
-    for (size_t i = 0; i < buffer.size(); ++i) {
-        SplatView sv = buffer[i];
+    for_each_splat([&](const SplatView& sv) {
         result.bounds.expand_pos(sv.pos());
 
         // Linear scale
@@ -139,27 +371,28 @@ EncodedEnvironment GridEncoder::encode_environment(const std::filesystem::path&
         result.bounds.expand_scale(linear_scale);
 
         // SH coefficients
+        float scratch[MAX_F_REST];
+        const float* f_rest = sv.sh_rest(scratch);
+        int bands_per_channel = sv.num_f_rest() / 3;
         for (int band = 0; band < bands_per_channel; ++band) {
-            float r = sv.f_rest(band);
-            float g = sv.f_rest(band + bands_per_channel);
-            float b = sv.f_rest(band + 2 * bands_per_channel);
+            float r = f_rest[band];
+            float g = f_rest[band + bands_per_channel];
+            float b = f_rest[band + 2 * bands_per_channel];
             result.bounds.expand_sh(r, g, b);
         }
-    }
+    });
 
     // Encode splats
     // Quality mode: 96 bytes per splat (32 data + 64 SH)
     // Portable mode: 32 bytes per splat (data only)
     const size_t bytes_per_splat = has_sh ? 96 : 32;
-    result.data.resize(buffer.size() * bytes_per_splat);
+    result.data.resize(result.count * bytes_per_splat);
 
     uint8_t* out = result.data.data();
 
-    for (size_t i = 0; i < buffer.size(); ++i) {
-        SplatView sv = buffer[i];
-
+    for_each_splat([&](const SplatView& sv) {
         // Position (12 bytes)
-        const Vec3f& pos = sv.pos();
+        const Vec3f pos = sv.pos();
         std::memcpy(out, &pos.x, 4);
         std::memcpy(out + 4, &pos.y, 4);
         std::memcpy(out + 8, &pos.z, 4);
@@ -175,7 +408,8 @@ EncodedEnvironment GridEncoder::encode_environment(const std::filesystem::path&
         std::memcpy(out + 16, scale_encoded, 6);
 
         // Rotation (4 bytes)
-        float rot[4] = {sv.rot().w, sv.rot().x, sv.rot().y, sv.rot().z};
+        const Quat q = sv.rot();
+        float rot[4] = {q.w, q.x, q.y, q.z};
         uint32_t rot_encoded = encode_rotation(rot);
         std::memcpy(out + 22, &rot_encoded, 4);
 
@@ -187,9 +421,11 @@ EncodedEnvironment GridEncoder::encode_environment(const std::filesystem::path&
             float sh_min_scalar = std::min({result.bounds.sh_min.x, result.bounds.sh_min.y, result.bounds.sh_min.z});
             float sh_max_scalar = std::max({result.bounds.sh_max.x, result.bounds.sh_max.y, result.bounds.sh_max.z});
 
+            float scratch[MAX_F_REST];
+            const float* coeffs = sv.sh_rest(scratch);
             float f_rest[45] = {0};
-            for (int j = 0; j < num_f_rest && j < 45; ++j) {
-                f_rest[j] = sv.f_rest(j);
+            for (int j = 0; j < sv.num_f_rest() && j < 45; ++j) {
+                f_rest[j] = coeffs[j];
             }
 
             uint32_t sh_encoded[16];
@@ -198,7 +434,7 @@ EncodedEnvironment GridEncoder::encode_environment(const std::filesystem::path&
         }
 
         out += bytes_per_splat;
-    }
+    });
 
     return result;
 }
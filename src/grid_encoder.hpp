@@ -3,6 +3,7 @@
 
 #include "lcc_types.hpp"
 #include "spatial_grid.hpp"
+#include "cell_manifest.hpp"
 #include <string>
 #include <vector>
 #include <filesystem>
@@ -10,12 +11,51 @@
 
 namespace ply2lcc {
 
+class SplatBuffer;
+
+// Splats for the environment stream: the given rows of a PLY file (all rows if empty)
+struct EnvironmentSource {
+    std::filesystem::path path;
+    std::vector<size_t> rows;
+};
+
 class GridEncoder {
 public:
     using ProgressCallback = std::function<void(int percent, const std::string&)>;
 
     void set_progress_callback(ProgressCallback cb) { progress_cb_ = std::move(cb); }
 
+    // Scatter mode: stream each LOD in file order, encoding every splat straight
+    // into its slot in preallocated cell buffers (sequential input access).
+    // Ignored in incremental mode, which hashes rows in gathered cell order.
+    void set_scatter(bool enabled) { scatter_ = enabled; }
+
+    // Gather mode: prefetch rows this many indices ahead (0 disables)
+    void set_prefetch_distance(int rows) { prefetch_distance_ = rows; }
+
+    // Gather mode: copy each cell's rows into a thread-local (huge-page backed)
+    // staging block before hashing/encoding
+    void set_stage_rows(bool enabled) { stage_rows_ = enabled; }
+
+    // Order of cells in the output files (see LccData::sort_cells)
+    void set_cell_layout(CellLayout layout) { cell_layout_ = layout; }
+
+    // Group all cells of each LOD contiguously, coarsest LOD first
+    void set_lod_major(bool enabled) { lod_major_ = enabled; }
+
+    // Incremental mode: hash each cell's input rows (EncodedCellData::hash)
+    void set_incremental(bool enabled) { incremental_ = enabled; }
+
+    // Rotation applied to every splat read, grid LODs and environment alike
+    // (SplatTransform::rotates); normally the grid's transform()
+    void set_transform(const SplatTransform& transform) { transform_ = transform; }
+
+    // Cells whose hash matches `manifest` reference `files` instead of being re-encoded
+    void set_previous_output(const CellManifest* manifest, const EncodedSource& files) {
+        previous_manifest_ = manifest;
+        previous_files_ = files;
+    }
+
     // Encode all cells from grid, returns complete LccData
     LccData encode(const SpatialGrid& grid,
                    const std::vector<std::filesystem::path>& lod_files);
@@ -23,10 +63,27 @@ public:
     // Encode environment PLY file
     EncodedEnvironment encode_environment(const std::filesystem::path& env_path, bool has_sh);
 
+    // Encode several sources into one environment stream with shared bounds.
+    // Sources that cannot be read are skipped.
+    EncodedEnvironment encode_environment(const std::vector<EnvironmentSource>& sources, bool has_sh);
+
 private:
     void report_progress(int percent, const std::string& msg);
 
+    void encode_lod_scatter(const SplatBuffer& splats, size_t lod,
+                            const std::vector<std::pair<uint32_t, const GridCell*>>& cells,
+                            const LccData& result, std::vector<EncodedCellData>& out);
+
     ProgressCallback progress_cb_;
+    bool scatter_ = false;
+    int prefetch_distance_ = 8;
+    bool stage_rows_ = false;
+    CellLayout cell_layout_ = CellLayout::Column;
+    bool lod_major_ = false;
+    bool incremental_ = false;
+    const CellManifest* previous_manifest_ = nullptr;
+    EncodedSource previous_files_;
+    SplatTransform transform_;
 };
 
 } // namespace ply2lcc
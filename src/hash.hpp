@@ -0,0 +1,149 @@
+#ifndef PLY2LCC_HASH_HPP
+#define PLY2LCC_HASH_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+namespace ply2lcc {
+
+/// Streaming XXH64 (xxHash 64-bit, same output as the reference XXH64()).
+/// Used for per-cell content hashes in incremental mode.
+class XXH64 {
+public:
+    explicit XXH64(uint64_t seed = 0) { reset(seed); }
+
+    void reset(uint64_t seed = 0) {
+        m_seed = seed;
+        m_v[0] = seed + P1 + P2;
+        m_v[1] = seed + P2;
+        m_v[2] = seed;
+        m_v[3] = seed - P1;
+        m_total = 0;
+        m_buffered = 0;
+    }
+
+    void update(const void* data, size_t len) {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        m_total += len;
+
+        if (m_buffered + len < 32) {
+            std::memcpy(m_buf + m_buffered, p, len);
+            m_buffered += len;
+            return;
+        }
+
+        if (m_buffered > 0) {
+            size_t fill = 32 - m_buffered;
+            std::memcpy(m_buf + m_buffered, p, fill);
+            consume_stripe(m_buf);
+            p += fill;
+            len -= fill;
+            m_buffered = 0;
+        }
+
+        while (len >= 32) {
+            consume_stripe(p);
+            p += 32;
+            len -= 32;
+        }
+
+        if (len > 0) {
+            std::memcpy(m_buf, p, len);
+            m_buffered = len;
+        }
+    }
+
+    template <typename T>
+    void update_pod(const T& v) { update(&v, sizeof(T)); }
+
+    uint64_t digest() const {
+        uint64_t h;
+        if (m_total >= 32) {
+            h = rotl(m_v[0], 1) + rotl(m_v[1], 7) + rotl(m_v[2], 12) + rotl(m_v[3], 18);
+            for (int i = 0; i < 4; ++i) {
+                h = (h ^ round(0, m_v[i])) * P1 + P4;
+            }
+        } else {
+            h = m_seed + P5;
+        }
+        h += m_total;
+
+        const uint8_t* p = m_buf;
+        size_t len = m_buffered;
+        while (len >= 8) {
+            h ^= round(0, read64(p));
+            h = rotl(h, 27) * P1 + P4;
+            p += 8;
+            len -= 8;
+        }
+        if (len >= 4) {
+            h ^= static_cast<uint64_t>(read32(p)) * P1;
+            h = rotl(h, 23) * P2 + P3;
+            p += 4;
+            len -= 4;
+        }
+        while (len > 0) {
+            h ^= (*p) * P5;
+            h = rotl(h, 11) * P1;
+            ++p;
+            --len;
+        }
+
+        h ^= h >> 33;
+        h *= P2;
+        h ^= h >> 29;
+        h *= P3;
+        h ^= h >> 32;
+        return h;
+    }
+
+    static uint64_t hash(const void* data, size_t len, uint64_t seed = 0) {
+        XXH64 h(seed);
+        h.update(data, len);
+        return h.digest();
+    }
+
+private:
+    static constexpr uint64_t P1 = 0x9E3779B185EBCA87ULL;
+    static constexpr uint64_t P2 = 0xC2B2AE3D27D4EB4FULL;
+    static constexpr uint64_t P3 = 0x165667B19E3779F9ULL;
+    static constexpr uint64_t P4 = 0x85EBCA77C2B2AE63ULL;
+    static constexpr uint64_t P5 = 0x27D4EB2F165667C5ULL;
+
+    static uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+    static uint64_t read64(const uint8_t* p) {
+        uint64_t v;
+        std::memcpy(&v, p, 8);
+        return v;
+    }
+
+    static uint32_t read32(const uint8_t* p) {
+        uint32_t v;
+        std::memcpy(&v, p, 4);
+        return v;
+    }
+
+    static uint64_t round(uint64_t acc, uint64_t input) {
+        acc += input * P2;
+        acc = rotl(acc, 31);
+        return acc * P1;
+    }
+
+    void consume_stripe(const uint8_t* p) {
+        for (int i = 0; i < 4; ++i) {
+            m_v[i] = round(m_v[i], read64(p + i * 8));
+        }
+    }
+
+    uint64_t m_seed = 0;
+    uint64_t m_v[4] = {};
+    uint64_t m_total = 0;
+    uint8_t m_buf[32] = {};
+    size_t m_buffered = 0;
+};
+
+} // namespace ply2lcc
+
+#endif // PLY2LCC_HASH_HPP
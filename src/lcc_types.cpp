@@ -1,5 +1,6 @@
 #include "lcc_types.hpp"
 #include <algorithm>
+#include <unordered_map>
 
 namespace ply2lcc {
 
@@ -29,15 +30,55 @@ BVHNode BVHNode::make_leaf(const float* bmin, const float* bmax,
     return n;
 }
 
+// Interleave the bits of x (even positions) and y (odd positions)
+static uint64_t morton_key_2d(uint32_t x, uint32_t y) {
+    uint64_t key = 0;
+    for (int b = 0; b < 16; ++b) {
+        key |= static_cast<uint64_t>((x >> b) & 1u) << (2 * b);
+        key |= static_cast<uint64_t>((y >> b) & 1u) << (2 * b + 1);
+    }
+    return key;
+}
+
+// Distance along the Hilbert curve filling the 65536 x 65536 cell grid
+static uint64_t hilbert_key_2d(uint32_t x, uint32_t y) {
+    const uint32_t n = 1u << 16;
+    uint64_t d = 0;
+    for (uint32_t s = n / 2; s > 0; s /= 2) {
+        uint32_t rx = (x & s) > 0;
+        uint32_t ry = (y & s) > 0;
+        d += static_cast<uint64_t>(s) * s * ((3 * rx) ^ ry);
+        if (ry == 0) {
+            if (rx == 1) {
+                x = n - 1 - x;
+                y = n - 1 - y;
+            }
+            std::swap(x, y);
+        }
+    }
+    return d;
+}
+
+static uint64_t layout_key(CellLayout layout, uint32_t cell_id) {
+    uint32_t x = cell_id & 0xFFFF;
+    uint32_t y = (cell_id >> 16) & 0xFFFF;
+    switch (layout) {
+        case CellLayout::ZOrder:  return morton_key_2d(x, y);
+        case CellLayout::Hilbert: return hilbert_key_2d(x, y);
+        case CellLayout::Column:  break;
+    }
+    // Sort by cell_x first (column), then cell_y (row)
+    return (static_cast<uint64_t>(x) << 16) | y;
+}
+
 void LccData::sort_cells() {
-    std::sort(cells.begin(), cells.end(), [](const EncodedCellData& a, const EncodedCellData& b) {
-        // Sort by cell_x first (column), then cell_y (row), then LOD
-        uint16_t ax = a.cell_id & 0xFFFF;
-        uint16_t ay = (a.cell_id >> 16) & 0xFFFF;
-        uint16_t bx = b.cell_id & 0xFFFF;
-        uint16_t by = (b.cell_id >> 16) & 0xFFFF;
-        if (ax != bx) return ax < bx;
-        if (ay != by) return ay < by;
+    const CellLayout layout = cell_layout;
+    const bool by_lod = lod_major;
+    std::sort(cells.begin(), cells.end(), [layout, by_lod](const EncodedCellData& a, const EncodedCellData& b) {
+        if (by_lod && a.lod != b.lod) return a.lod > b.lod;
+        uint64_t ka = layout_key(layout, a.cell_id);
+        uint64_t kb = layout_key(layout, b.cell_id);
+        if (ka != kb) return ka < kb;
         return a.lod < b.lod;
     });
 }
@@ -45,33 +86,39 @@ void LccData::sort_cells() {
 std::vector<LccUnitInfo> LccData::build_index(uint64_t& data_offset, uint64_t& sh_offset) const {
     std::vector<LccUnitInfo> units;
 
-    uint32_t current_cell_id = UINT32_MAX;
-    LccUnitInfo* current_unit = nullptr;
+    // In LOD-major layout a cell's LODs are not adjacent, so look units up by id
+    std::unordered_map<uint32_t, size_t> unit_of;
 
     for (const auto& cell : cells) {
         if (cell.count == 0) continue;
 
-        if (cell.cell_id != current_cell_id) {
+        auto [it, inserted] = unit_of.emplace(cell.cell_id, units.size());
+        if (inserted) {
             units.emplace_back();
-            current_unit = &units.back();
-            current_unit->index = cell.cell_id;
-            current_unit->lods.resize(num_lods);
-            current_cell_id = cell.cell_id;
+            units.back().index = cell.cell_id;
+            units.back().lods.resize(num_lods);
         }
 
-        LccNodeInfo& node = current_unit->lods[cell.lod];
+        LccNodeInfo& node = units[it->second].lods[cell.lod];
         node.splat_count = static_cast<uint32_t>(cell.count);
         node.data_offset = data_offset;
-        node.data_size = static_cast<uint32_t>(cell.data.size());
-        data_offset += cell.data.size();
+        node.data_size = static_cast<uint32_t>(cell.data_size());
+        data_offset += cell.data_size();
 
-        if (has_sh && !cell.shcoef.empty()) {
+        if (has_sh && cell.sh_size() > 0) {
             node.sh_offset = sh_offset;
-            node.sh_size = static_cast<uint32_t>(cell.shcoef.size());
-            sh_offset += cell.shcoef.size();
+            node.sh_size = static_cast<uint32_t>(cell.sh_size());
+            sh_offset += cell.sh_size();
         }
     }
 
+    if (lod_major) {
+        const CellLayout layout = cell_layout;
+        std::stable_sort(units.begin(), units.end(), [layout](const LccUnitInfo& a, const LccUnitInfo& b) {
+            return layout_key(layout, a.index) < layout_key(layout, b.index);
+        });
+    }
+
     return units;
 }
 
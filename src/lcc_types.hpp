@@ -16,9 +16,27 @@ struct EncodedCellData {
     size_t count;                   // Number of splats
     std::vector<uint8_t> data;      // Encoded splat data (32 bytes/splat)
     std::vector<uint8_t> shcoef;    // SH coefficients (64 bytes/splat, optional)
+    uint64_t hash = 0;              // Content hash of the input rows (incremental mode)
+
+    // Already-encoded bytes on disk (index into LccData::sources, -1 = in memory).
+    // When set, data/shcoef are empty and the writer copies the byte ranges instead.
+    int source = -1;
+    uint64_t source_data_offset = 0;
+    uint64_t source_sh_offset = 0;
+    size_t source_data_size = 0;
+    size_t source_sh_size = 0;
 
     EncodedCellData() : cell_id(0), lod(0), count(0) {}
     EncodedCellData(uint32_t id, size_t l) : cell_id(id), lod(l), count(0) {}
+
+    size_t data_size() const { return source < 0 ? data.size() : source_data_size; }
+    size_t sh_size() const { return source < 0 ? shcoef.size() : source_sh_size; }
+};
+
+// Existing data.bin/shcoef.bin pair that EncodedCellData::source refers to
+struct EncodedSource {
+    std::filesystem::path data_path;
+    std::filesystem::path sh_path;
 };
 
 // Environment data (encoded same format as cells)
@@ -102,6 +120,7 @@ struct LccUnitInfo {
 // Complete output data - passed from Encoder to Writer
 struct LccData {
     std::vector<EncodedCellData> cells;     // All cells, all LODs
+    std::vector<EncodedSource> sources;     // On-disk segments referenced by cells
     EncodedEnvironment environment;          // Optional
     CollisionData collision;                 // Optional
     std::filesystem::path poses_path;                  // Optional
@@ -118,14 +137,37 @@ struct LccData {
     // Config values for meta.lcc
     float cell_size_x = 30.0f;
     float cell_size_y = 30.0f;
+    double offset[3] = {0.0, 0.0, 0.0};  // Translation of --transform
+    double scale = 1.0;                  // Uniform scale of --transform
+
+    // Order of cells on disk
+    CellLayout cell_layout = CellLayout::Column;
+    bool lod_major = false;   // Group cells by LOD, coarsest first
 
-    // Sort cells by (cell_id, lod) for sequential write
+    // Sort cells by (layout key of cell_id, lod) for sequential write,
+    // or by (descending lod, layout key) when lod_major is set
     void sort_cells();
 
-    // Build index units from sorted cells
+    // Build index units (in cell layout order) from sorted cells
     std::vector<LccUnitInfo> build_index(uint64_t& data_offset, uint64_t& sh_offset) const;
 };
 
+// One sub-scene of a split output, written as a complete LCC directory
+struct SceneEntry {
+    std::string path;       // Directory relative to the manifest
+    BBox bounds;            // Space assigned to the scene (layer slab or tile)
+    BBox bbox;              // Splats actually in it
+    size_t total_splats = 0;
+};
+
+// Top-level scenes.json listing the sub-scenes of a split output
+struct SceneManifest {
+    std::string type;       // "layers" or "tiles"
+    float step = 0.0f;      // Layer height or tile size in meters
+    BBox bbox;              // Union of the sub-scenes
+    std::vector<SceneEntry> scenes;
+};
+
 } // namespace ply2lcc
 
 #endif // PLY2LCC_LCC_TYPES_HPP
@@ -6,6 +6,9 @@
 #include <random>
 #include <filesystem>
 #include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
 
 namespace fs = std::filesystem;
 
@@ -136,28 +139,81 @@ void LccWriter::write_collision(const LccData& data) {
 }
 
 void LccWriter::write_data_bin(const LccData& data) {
-    auto data_file = platform::ofstream_open(output_dir_ / "data.bin");
+    const fs::path data_path = output_dir_ / "data.bin";
+    const fs::path sh_path = output_dir_ / "shcoef.bin";
+
+    // Write to temporaries: cells may be copied out of the previous data.bin/shcoef.bin
+    fs::path data_tmp = data_path;
+    data_tmp += ".tmp";
+    fs::path sh_tmp = sh_path;
+    sh_tmp += ".tmp";
+
+    std::unique_ptr<FILE, int (*)(FILE*)> data_file(platform::fopen(data_tmp, "wb"), &std::fclose);
     if (!data_file) {
         throw std::runtime_error("Failed to create data.bin");
     }
 
-    std::ofstream sh_file;
+    std::unique_ptr<FILE, int (*)(FILE*)> sh_file(nullptr, &std::fclose);
     if (data.has_sh) {
-        sh_file = platform::ofstream_open(output_dir_ / "shcoef.bin");
+        sh_file.reset(platform::fopen(sh_tmp, "wb"));
         if (!sh_file) {
             throw std::runtime_error("Failed to create shcoef.bin");
         }
     }
 
-    for (const auto& cell : data.cells) {
-        if (cell.count == 0) continue;
-
-        data_file.write(reinterpret_cast<const char*>(cell.data.data()), cell.data.size());
+    {
+        // On-disk segments referenced by cells (closed before the rename below)
+        struct SourceFiles {
+            std::vector<platform::FileHandle> data, sh;
+            ~SourceFiles() {
+                for (auto& h : data) platform::file_close(h);
+                for (auto& h : sh) platform::file_close(h);
+            }
+        } sources;
+        for (const auto& src : data.sources) {
+            sources.data.push_back(platform::file_open(src.data_path));
+            sources.sh.push_back(data.has_sh ? platform::file_open(src.sh_path) : platform::FileHandle{});
+        }
 
-        if (data.has_sh && !cell.shcoef.empty()) {
-            sh_file.write(reinterpret_cast<const char*>(cell.shcoef.data()), cell.shcoef.size());
+        for (const auto& cell : data.cells) {
+            if (cell.count == 0) continue;
+
+            if (cell.source < 0) {
+                if (std::fwrite(cell.data.data(), 1, cell.data.size(), data_file.get()) != cell.data.size()) {
+                    throw std::runtime_error("Failed to write data.bin");
+                }
+                if (data.has_sh && !cell.shcoef.empty() &&
+                    std::fwrite(cell.shcoef.data(), 1, cell.shcoef.size(), sh_file.get()) != cell.shcoef.size()) {
+                    throw std::runtime_error("Failed to write shcoef.bin");
+                }
+                continue;
+            }
+
+            auto src = static_cast<size_t>(cell.source);
+            if (!platform::copy_file_range(sources.data[src], cell.source_data_offset,
+                                           cell.source_data_size, data_file.get())) {
+                throw std::runtime_error("Failed to copy cell data from " + data.sources[src].data_path.u8string());
+            }
+            if (data.has_sh && cell.source_sh_size > 0 &&
+                !platform::copy_file_range(sources.sh[src], cell.source_sh_offset,
+                                           cell.source_sh_size, sh_file.get())) {
+                throw std::runtime_error("Failed to copy SH data from " + data.sources[src].sh_path.u8string());
+            }
         }
     }
+
+    bool ok = std::fflush(data_file.get()) == 0;
+    if (sh_file) ok = ok && std::fflush(sh_file.get()) == 0;
+    data_file.reset();
+    sh_file.reset();
+    if (!ok) {
+        throw std::runtime_error("Failed to flush data.bin/shcoef.bin");
+    }
+
+    fs::rename(data_tmp, data_path);
+    if (data.has_sh) {
+        fs::rename(sh_tmp, sh_path);
+    }
 }
 
 void LccWriter::write_index_bin(const LccData& data) {
@@ -186,6 +242,43 @@ void LccWriter::write_index_bin(const LccData& data) {
     }
 }
 
+void LccWriter::write_manifest(const SceneManifest& manifest) {
+    auto file = platform::ofstream_open(output_dir_ / "scenes.json", std::ios::out);
+    if (!file) {
+        throw std::runtime_error("Failed to create scenes.json");
+    }
+
+    file << std::setprecision(15);
+
+    file << "{\n";
+    file << "\t\"version\": \"1.0\",\n";
+    file << "\t\"type\": \"" << manifest.type << "\",\n";
+    file << "\t\"" << (manifest.type == "tiles" ? "tileSize" : "layerHeight") << "\": " << manifest.step << ",\n";
+    file << "\t\"boundingBox\": {\n";
+    file << "\t\t\"min\": [" << manifest.bbox.min.x << ", " << manifest.bbox.min.y << ", " << manifest.bbox.min.z << "],\n";
+    file << "\t\t\"max\": [" << manifest.bbox.max.x << ", " << manifest.bbox.max.y << ", " << manifest.bbox.max.z << "]\n";
+    file << "\t},\n";
+
+    file << "\t\"scenes\": [\n";
+    for (size_t i = 0; i < manifest.scenes.size(); ++i) {
+        const SceneEntry& scene = manifest.scenes[i];
+        file << "\t\t{\n";
+        file << "\t\t\t\"path\": \"" << scene.path << "/meta.lcc\",\n";
+        file << "\t\t\t\"totalSplats\": " << scene.total_splats << ",\n";
+        file << "\t\t\t\"bounds\": {\n";
+        file << "\t\t\t\t\"min\": [" << scene.bounds.min.x << ", " << scene.bounds.min.y << ", " << scene.bounds.min.z << "],\n";
+        file << "\t\t\t\t\"max\": [" << scene.bounds.max.x << ", " << scene.bounds.max.y << ", " << scene.bounds.max.z << "]\n";
+        file << "\t\t\t},\n";
+        file << "\t\t\t\"boundingBox\": {\n";
+        file << "\t\t\t\t\"min\": [" << scene.bbox.min.x << ", " << scene.bbox.min.y << ", " << scene.bbox.min.z << "],\n";
+        file << "\t\t\t\t\"max\": [" << scene.bbox.max.x << ", " << scene.bbox.max.y << ", " << scene.bbox.max.z << "]\n";
+        file << "\t\t\t}\n";
+        file << "\t\t}" << (i + 1 < manifest.scenes.size() ? "," : "") << "\n";
+    }
+    file << "\t]\n";
+    file << "}\n";
+}
+
 std::string LccWriter::generate_guid() {
     std::random_device rd;
     std::mt19937 gen(rd());
@@ -221,10 +314,10 @@ void LccWriter::write_meta_lcc(const LccData& data) {
     file << "\t\"cellLengthX\": " << data.cell_size_x << ",\n";
     file << "\t\"cellLengthY\": " << data.cell_size_y << ",\n";
     file << "\t\"indexDataSize\": " << (4 + 16 * data.num_lods) << ",\n";
-    file << "\t\"offset\": [0, 0, 0],\n";
+    file << "\t\"offset\": [" << data.offset[0] << ", " << data.offset[1] << ", " << data.offset[2] << "],\n";
     file << "\t\"epsg\": 0,\n";
     file << "\t\"shift\": [0, 0, 0],\n";
-    file << "\t\"scale\": [1, 1, 1],\n";
+    file << "\t\"scale\": [" << data.scale << ", " << data.scale << ", " << data.scale << "],\n";
 
     // Splats per LOD
     file << "\t\"splats\": [";
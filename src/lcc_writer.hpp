@@ -14,6 +14,9 @@ public:
     // Write complete LCC output (all files including environment and collision if present)
     void write(const LccData& data);
 
+    // Write scenes.json for an output split into sub-scene directories
+    void write_manifest(const SceneManifest& manifest);
+
 private:
     void write_data_bin(const LccData& data);
     void write_index_bin(const LccData& data);
@@ -0,0 +1,440 @@
+#include "lod_builder.hpp"
+#include "splat_buffer.hpp"
+#include "platform.hpp"
+#include <omp.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace ply2lcc {
+
+namespace {
+
+// Row field offsets (in floats) relative to SplatRows::stride()
+constexpr size_t POS = 0;
+constexpr size_t F_DC = 3;
+constexpr size_t F_REST = 6;
+
+constexpr int BISECTION_STEPS = 16;
+constexpr double MIN_VARIANCE = 1e-12;
+constexpr double MIN_OPACITY = 1e-4;
+constexpr double MAX_OPACITY = 0.9999;
+
+struct RowLayout {
+    size_t opacity, scale, rot, stride;
+    int num_f_rest;
+
+    explicit RowLayout(const SplatRows& rows)
+        : opacity(F_REST + static_cast<size_t>(rows.num_f_rest))
+        , scale(opacity + 1)
+        , rot(scale + 3)
+        , stride(rows.stride())
+        , num_f_rest(rows.num_f_rest) {}
+};
+
+// Rotation matrix (columns are the local axes) from quaternion (w, x, y, z)
+void quat_to_matrix(const float* q, double r[3][3]) {
+    double w = q[0], x = q[1], y = q[2], z = q[3];
+    double n = std::sqrt(w * w + x * x + y * y + z * z);
+    if (n > 0.0) {
+        w /= n; x /= n; y /= n; z /= n;
+    } else {
+        w = 1.0;
+    }
+    r[0][0] = 1 - 2 * (y * y + z * z); r[0][1] = 2 * (x * y - w * z);     r[0][2] = 2 * (x * z + w * y);
+    r[1][0] = 2 * (x * y + w * z);     r[1][1] = 1 - 2 * (x * x + z * z); r[1][2] = 2 * (y * z - w * x);
+    r[2][0] = 2 * (x * z - w * y);     r[2][1] = 2 * (y * z + w * x);     r[2][2] = 1 - 2 * (x * x + y * y);
+}
+
+void matrix_to_quat(const double r[3][3], float* q) {
+    double w, x, y, z;
+    double trace = r[0][0] + r[1][1] + r[2][2];
+    if (trace > 0.0) {
+        double s = std::sqrt(trace + 1.0) * 2.0;
+        w = 0.25 * s;
+        x = (r[2][1] - r[1][2]) / s;
+        y = (r[0][2] - r[2][0]) / s;
+        z = (r[1][0] - r[0][1]) / s;
+    } else if (r[0][0] > r[1][1] && r[0][0] > r[2][2]) {
+        double s = std::sqrt(1.0 + r[0][0] - r[1][1] - r[2][2]) * 2.0;
+        w = (r[2][1] - r[1][2]) / s;
+        x = 0.25 * s;
+        y = (r[0][1] + r[1][0]) / s;
+        z = (r[0][2] + r[2][0]) / s;
+    } else if (r[1][1] > r[2][2]) {
+        double s = std::sqrt(1.0 + r[1][1] - r[0][0] - r[2][2]) * 2.0;
+        w = (r[0][2] - r[2][0]) / s;
+        x = (r[0][1] + r[1][0]) / s;
+        y = 0.25 * s;
+        z = (r[1][2] + r[2][1]) / s;
+    } else {
+        double s = std::sqrt(1.0 + r[2][2] - r[0][0] - r[1][1]) * 2.0;
+        w = (r[1][0] - r[0][1]) / s;
+        x = (r[0][2] + r[2][0]) / s;
+        y = (r[1][2] + r[2][1]) / s;
+        z = 0.25 * s;
+    }
+    q[0] = static_cast<float>(w);
+    q[1] = static_cast<float>(x);
+    q[2] = static_cast<float>(y);
+    q[3] = static_cast<float>(z);
+}
+
+// Cyclic Jacobi eigen-decomposition of a symmetric 3x3 matrix (destroys a).
+// Eigenvectors are returned as the columns of v.
+void jacobi_eigen(double a[3][3], double eval[3], double v[3][3]) {
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            v[i][j] = (i == j) ? 1.0 : 0.0;
+
+    for (int sweep = 0; sweep < 32; ++sweep) {
+        double off = a[0][1] * a[0][1] + a[0][2] * a[0][2] + a[1][2] * a[1][2];
+        double diag = a[0][0] * a[0][0] + a[1][1] * a[1][1] + a[2][2] * a[2][2];
+        if (off <= 1e-30 * diag || off == 0.0) break;
+
+        for (int p = 0; p < 2; ++p) {
+            for (int q = p + 1; q < 3; ++q) {
+                if (a[p][q] == 0.0) continue;
+                double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+                double t = (theta >= 0.0 ? 1.0 : -1.0) / (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+                double c = 1.0 / std::sqrt(t * t + 1.0);
+                double s = t * c;
+
+                for (int k = 0; k < 3; ++k) {
+                    double akp = a[k][p], akq = a[k][q];
+                    a[k][p] = c * akp - s * akq;
+                    a[k][q] = s * akp + c * akq;
+                }
+                for (int k = 0; k < 3; ++k) {
+                    double apk = a[p][k], aqk = a[q][k];
+                    a[p][k] = c * apk - s * aqk;
+                    a[q][k] = s * apk + c * aqk;
+                }
+                for (int k = 0; k < 3; ++k) {
+                    double vkp = v[k][p], vkq = v[k][q];
+                    v[k][p] = c * vkp - s * vkq;
+                    v[k][q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+
+    for (int i = 0; i < 3; ++i) eval[i] = a[i][i];
+}
+
+// Area of the largest cross-section (up to pi): product of the two largest axes
+double cross_section(double s0, double s1, double s2) {
+    double lo = std::min(s0, std::min(s1, s2));
+    return s0 * s1 * s2 / std::max(lo, 1e-30);
+}
+
+uint64_t voxel_key(const float* pos, const Vec3f& origin, double inv_voxel) {
+    auto q = [&](int a) {
+        return static_cast<uint64_t>(std::max(0.0, (pos[a] - origin[a]) * inv_voxel)) & 0x1FFFFF;
+    };
+    return q(0) | (q(1) << 21) | (q(2) << 42);
+}
+
+size_t count_voxels(const SplatRows& in, const Vec3f& origin, double voxel,
+                    std::unordered_set<uint64_t>& scratch) {
+    scratch.clear();
+    const double inv = 1.0 / voxel;
+    for (size_t i = 0; i < in.size(); ++i) {
+        scratch.insert(voxel_key(in.row(i) + POS, origin, inv));
+    }
+    return scratch.size();
+}
+
+// Weighted moments of the splats in one voxel
+struct Moments {
+    double weight = 0.0;
+    double mass = 0.0;        // sum of opacity x cross-section
+    double pos[3] = {};
+    double second[6] = {};    // xx xy xz yy yz zz of (covariance + mean mean^T)
+    std::vector<double> color; // f_dc + f_rest
+    size_t count = 0;
+    size_t first = 0;
+};
+
+} // namespace
+
+SplatRows merge_to_budget(const SplatRows& in, size_t budget) {
+    const size_t n = in.size();
+    if (n <= budget || n == 0) return in;
+    budget = std::max<size_t>(budget, 1);
+
+    const RowLayout L(in);
+
+    BBox bounds;
+    for (size_t i = 0; i < n; ++i) {
+        const float* p = in.row(i) + POS;
+        bounds.expand(Vec3f(p[0], p[1], p[2]));
+    }
+    const Vec3f origin = bounds.min;
+    double extent = std::max({bounds.max.x - bounds.min.x, bounds.max.y - bounds.min.y,
+                              bounds.max.z - bounds.min.z, 1e-6f});
+
+    // Bisection (in log space) for the smallest voxel keeping the count within budget
+    std::unordered_set<uint64_t> scratch;
+    scratch.reserve(n);
+    double hi = extent * 1.01;                 // a single voxel
+    double lo = hi * 1e-5;
+    if (count_voxels(in, origin, lo, scratch) <= budget) {
+        hi = lo;
+    } else {
+        for (int step = 0; step < BISECTION_STEPS; ++step) {
+            double mid = std::sqrt(lo * hi);
+            if (count_voxels(in, origin, mid, scratch) <= budget) {
+                hi = mid;
+            } else {
+                lo = mid;
+            }
+        }
+    }
+
+    // Accumulate moments per voxel
+    const double inv_voxel = 1.0 / hi;
+    const size_t num_color = 3 + static_cast<size_t>(L.num_f_rest);
+    std::unordered_map<uint64_t, size_t> voxel_of;
+    voxel_of.reserve(budget * 2);
+    std::vector<Moments> voxels;
+
+    for (size_t i = 0; i < n; ++i) {
+        const float* row = in.row(i);
+        auto [it, inserted] = voxel_of.emplace(voxel_key(row + POS, origin, inv_voxel), voxels.size());
+        if (inserted) {
+            voxels.emplace_back();
+            voxels.back().color.assign(num_color, 0.0);
+            voxels.back().first = i;
+        }
+        Moments& m = voxels[it->second];
+
+        double s[3];
+        for (int a = 0; a < 3; ++a) s[a] = std::exp(static_cast<double>(row[L.scale + a]));
+        double alpha = sigmoid(row[L.opacity]);
+        double mass = alpha * cross_section(s[0], s[1], s[2]);
+        double w = std::max(mass, 1e-30);
+
+        double r[3][3];
+        quat_to_matrix(row + L.rot, r);
+
+        // Position relative to origin keeps the second moments well conditioned
+        double mu[3];
+        for (int a = 0; a < 3; ++a) mu[a] = static_cast<double>(row[POS + a]) - origin[a];
+
+        int k = 0;
+        for (int a = 0; a < 3; ++a) {
+            for (int b = a; b < 3; ++b) {
+                double cov = 0.0;
+                for (int j = 0; j < 3; ++j) cov += r[a][j] * s[j] * s[j] * r[b][j];
+                m.second[k++] += w * (cov + mu[a] * mu[b]);
+            }
+        }
+        for (int a = 0; a < 3; ++a) m.pos[a] += w * mu[a];
+        for (size_t c = 0; c < num_color; ++c) m.color[c] += w * row[F_DC + c];
+        m.weight += w;
+        m.mass += mass;
+        m.count++;
+    }
+
+    SplatRows out;
+    out.num_f_rest = in.num_f_rest;
+    out.values.resize(voxels.size() * L.stride);
+
+    for (size_t v = 0; v < voxels.size(); ++v) {
+        const Moments& m = voxels[v];
+        float* dst = out.row(v);
+
+        // A lone splat is kept exactly
+        if (m.count == 1) {
+            std::memcpy(dst, in.row(m.first), L.stride * sizeof(float));
+            continue;
+        }
+
+        const double inv_w = 1.0 / m.weight;
+        double mean[3];
+        for (int a = 0; a < 3; ++a) mean[a] = m.pos[a] * inv_w;
+
+        double cov[3][3];
+        int k = 0;
+        for (int a = 0; a < 3; ++a) {
+            for (int b = a; b < 3; ++b) {
+                cov[a][b] = cov[b][a] = m.second[k++] * inv_w - mean[a] * mean[b];
+            }
+        }
+
+        double eval[3], evec[3][3];
+        jacobi_eigen(cov, eval, evec);
+
+        // Proper rotation: flip one axis if the eigenbasis is left-handed
+        double det = evec[0][0] * (evec[1][1] * evec[2][2] - evec[1][2] * evec[2][1])
+                   - evec[0][1] * (evec[1][0] * evec[2][2] - evec[1][2] * evec[2][0])
+                   + evec[0][2] * (evec[1][0] * evec[2][1] - evec[1][1] * evec[2][0]);
+        if (det < 0.0) {
+            for (int a = 0; a < 3; ++a) evec[a][2] = -evec[a][2];
+        }
+
+        double s[3];
+        for (int a = 0; a < 3; ++a) s[a] = std::sqrt(std::max(eval[a], MIN_VARIANCE));
+
+        double alpha = std::clamp(m.mass / cross_section(s[0], s[1], s[2]), MIN_OPACITY, MAX_OPACITY);
+
+        for (int a = 0; a < 3; ++a) dst[POS + a] = static_cast<float>(mean[a] + origin[a]);
+        for (size_t c = 0; c < num_color; ++c) dst[F_DC + c] = static_cast<float>(m.color[c] * inv_w);
+        dst[L.opacity] = static_cast<float>(std::log(alpha / (1.0 - alpha)));
+        for (int a = 0; a < 3; ++a) dst[L.scale + a] = static_cast<float>(std::log(s[a]));
+        matrix_to_quat(evec, dst + L.rot);
+    }
+
+    return out;
+}
+
+std::vector<size_t> LodBuilder::default_budgets(size_t lod0_splats, int levels) {
+    std::vector<size_t> budgets;
+    size_t budget = lod0_splats;
+    for (int k = 0; k < levels; ++k) {
+        budget = std::max<size_t>(budget / 4, 1);
+        budgets.push_back(budget);
+    }
+    return budgets;
+}
+
+static void write_level_ply(const std::filesystem::path& path, int num_f_rest,
+                            const std::vector<const SplatRows*>& cells, size_t total) {
+    auto out = platform::ofstream_open(path);
+    if (!out) {
+        throw std::runtime_error("Failed to create " + path.u8string());
+    }
+
+    out << "ply\nformat binary_little_endian 1.0\n"
+        << "element vertex " << total << "\n"
+        << "property float x\nproperty float y\nproperty float z\n"
+        << "property float f_dc_0\nproperty float f_dc_1\nproperty float f_dc_2\n";
+    for (int i = 0; i < num_f_rest; ++i) {
+        out << "property float f_rest_" << i << "\n";
+    }
+    out << "property float opacity\n"
+        << "property float scale_0\nproperty float scale_1\nproperty float scale_2\n"
+        << "property float rot_0\nproperty float rot_1\nproperty float rot_2\nproperty float rot_3\n"
+        << "end_header\n";
+
+    for (const SplatRows* rows : cells) {
+        out.write(reinterpret_cast<const char*>(rows->values.data()),
+                  static_cast<std::streamsize>(rows->values.size() * sizeof(float)));
+    }
+
+    if (!out) {
+        throw std::runtime_error("Failed to write " + path.u8string());
+    }
+}
+
+std::vector<std::filesystem::path> LodBuilder::build(SpatialGrid& grid,
+                                                     const std::filesystem::path& lod0_file,
+                                                     const std::filesystem::path& out_dir) {
+    std::vector<std::filesystem::path> files;
+    if (budgets_.empty()) return files;
+
+    // Levels are merged and written in the input frame, like the files they join;
+    // only their SH ranges are taken after the grid's rotation
+    SplatBuffer splats;
+    if (!splats.initialize(lod0_file)) {
+        throw std::runtime_error("Failed to read " + lod0_file.u8string() + ": " + splats.error());
+    }
+
+    const int num_f_rest = grid.num_f_rest();
+    const SplatTransform& transform = grid.transform();
+    const size_t num_levels = budgets_.size();
+
+    std::vector<std::pair<uint32_t, const std::vector<size_t>*>> cells;
+    size_t lod0_total = 0;
+    for (const auto& [id, cell] : grid.cells()) {
+        if (cell.splat_indices[0].empty()) continue;
+        cells.emplace_back(id, &cell.splat_indices[0]);
+        lod0_total += cell.splat_indices[0].size();
+    }
+    if (lod0_total == 0) return files;
+
+    // levels[c][k] = LOD k+1 of cell c
+    std::vector<std::vector<SplatRows>> levels(cells.size());
+    const auto num_cells = static_cast<ptrdiff_t>(cells.size());
+
+    #pragma omp parallel for schedule(dynamic)
+    for (ptrdiff_t c = 0; c < num_cells; ++c) {
+        const auto& indices = *cells[static_cast<size_t>(c)].second;
+
+        SplatRows rows;
+        rows.num_f_rest = num_f_rest;
+        rows.values.resize(indices.size() * rows.stride());
+        for (size_t i = 0; i < indices.size(); ++i) {
+            SplatView sv = splats[indices[i]];
+            float* dst = rows.row(i);
+            size_t k = 0;
+            for (int a = 0; a < 3; ++a) dst[k++] = sv.pos()[a];
+            for (int a = 0; a < 3; ++a) dst[k++] = sv.f_dc()[a];
+            for (int j = 0; j < num_f_rest; ++j) dst[k++] = sv.f_rest(j);
+            dst[k++] = sv.opacity();
+            for (int a = 0; a < 3; ++a) dst[k++] = sv.scale()[a];
+            for (int a = 0; a < 4; ++a) dst[k++] = sv.rot()[a];
+        }
+
+        // Each level is merged from the previous one. Every cell keeps at least
+        // one splat; the rest of the level's budget is shared in proportion to
+        // the LOD0 count and rounded down, so the level total stays within budget
+        // unless it is smaller than the number of cells
+        auto& cell_levels = levels[static_cast<size_t>(c)];
+        cell_levels.reserve(num_levels);
+        const double share = static_cast<double>(indices.size()) / static_cast<double>(lod0_total);
+        for (size_t k = 0; k < num_levels; ++k) {
+            size_t spare = budgets_[k] > cells.size() ? budgets_[k] - cells.size() : 0;
+            size_t budget = 1 + static_cast<size_t>(share * static_cast<double>(spare));
+            cell_levels.push_back(merge_to_budget(k == 0 ? rows : cell_levels[k - 1], budget));
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(out_dir, ec);
+    const int bands_per_channel = num_f_rest / 3;
+    std::vector<float> rotated(static_cast<size_t>(num_f_rest));
+
+    for (size_t k = 0; k < num_levels; ++k) {
+        ThreadLocalGrid level;
+        std::vector<const SplatRows*> level_cells;
+        size_t next_row = 0;
+
+        for (size_t c = 0; c < cells.size(); ++c) {
+            const SplatRows& rows = levels[c][k];
+            const RowLayout L(rows);
+            for (size_t i = 0; i < rows.size(); ++i) {
+                const float* row = rows.row(i);
+                level.cell_ids.push_back(cells[c].first);
+                level.rows.push_back(next_row++);
+                level.ranges.expand_scale(Vec3f(std::exp(row[L.scale]), std::exp(row[L.scale + 1]),
+                                                std::exp(row[L.scale + 2])));
+                level.ranges.expand_opacity(sigmoid(row[L.opacity]));
+                const float* f_rest = row + F_REST;
+                if (transform.rotates()) {
+                    std::copy(f_rest, f_rest + num_f_rest, rotated.begin());
+                    transform.apply_sh(rotated.data(), num_f_rest);
+                    f_rest = rotated.data();
+                }
+                for (int band = 0; band < bands_per_channel; ++band) {
+                    level.ranges.expand_sh(f_rest[band], f_rest[band + bands_per_channel],
+                                           f_rest[band + 2 * bands_per_channel]);
+                }
+            }
+            level_cells.push_back(&rows);
+        }
+
+        auto path = out_dir / ("lod_" + std::to_string(k + 1) + ".ply");
+        write_level_ply(path, num_f_rest, level_cells, next_row);
+        grid.append_lod(std::move(level));
+        files.push_back(path);
+    }
+
+    return files;
+}
+
+} // namespace ply2lcc
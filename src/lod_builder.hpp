@@ -0,0 +1,52 @@
+#ifndef PLY2LCC_LOD_BUILDER_HPP
+#define PLY2LCC_LOD_BUILDER_HPP
+
+#include "types.hpp"
+#include "spatial_grid.hpp"
+#include <cstddef>
+#include <vector>
+#include <filesystem>
+
+namespace ply2lcc {
+
+// Splats as packed float rows in the property order of the generated PLY files:
+// x y z, f_dc_0..2, f_rest_0..N-1, opacity, scale_0..2, rot_0..3
+struct SplatRows {
+    int num_f_rest = 0;
+    std::vector<float> values;
+
+    size_t stride() const { return 14 + static_cast<size_t>(num_f_rest); }
+    size_t size() const { return values.size() / stride(); }
+    float* row(size_t i) { return values.data() + i * stride(); }
+    const float* row(size_t i) const { return values.data() + i * stride(); }
+};
+
+// Merge splats into at most `budget` splats. All splats sharing a voxel are
+// replaced by one moment-matched Gaussian (weighted mean and covariance,
+// opacity-area mass conserved, weighted SH); the voxel size is the smallest
+// found by bisection that keeps the voxel count within budget.
+SplatRows merge_to_budget(const SplatRows& in, size_t budget);
+
+// Builds coarser LOD levels from a grid's LOD0 rows.
+class LodBuilder {
+public:
+    // budgets[k] is the total splat budget of LOD k+1
+    explicit LodBuilder(std::vector<size_t> budgets) : budgets_(std::move(budgets)) {}
+
+    // Budgets that divide the splat count by 4 per level
+    static std::vector<size_t> default_budgets(size_t lod0_splats, int levels);
+
+    // Merge every cell independently (in parallel) for each level, write level k
+    // to out_dir/lod_<k>.ply and append it to `grid` as LOD k.
+    // Returns the written files in LOD order.
+    std::vector<std::filesystem::path> build(SpatialGrid& grid,
+                                             const std::filesystem::path& lod0_file,
+                                             const std::filesystem::path& out_dir);
+
+private:
+    std::vector<size_t> budgets_;
+};
+
+} // namespace ply2lcc
+
+#endif // PLY2LCC_LOD_BUILDER_HPP
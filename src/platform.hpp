@@ -9,15 +9,23 @@
 
 #include <vector>
 #include <string>
+#include <algorithm>
 
 #ifdef _WIN32
 #include <windows.h>
 #include <shellapi.h>
+#if defined(_M_X64) || defined(_M_IX86)
+#include <xmmintrin.h>
+#endif
 #else
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <cerrno>
+extern char** environ;
 #endif
 
 namespace platform {
@@ -133,6 +141,175 @@ inline void madvise(void* addr, std::size_t length, AccessHint hint) {
 #endif
 }
 
+/// Hint the CPU to pull the cache line containing addr (read access)
+inline void prefetch(const void* addr) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(addr, 0, 3);
+#elif defined(_M_X64) || defined(_M_IX86)
+    _mm_prefetch(static_cast<const char*>(addr), _MM_HINT_T0);
+#else
+    (void)addr;
+#endif
+}
+
+/// Allocate a large zero-filled buffer, backed by huge pages where the kernel allows
+/// (transparent huge pages on Linux). Release with free_large(). Returns nullptr on failure.
+inline void* alloc_large(std::size_t length) {
+    if (length == 0) return nullptr;
+#ifdef _WIN32
+    return VirtualAlloc(nullptr, length, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+    void* addr = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (addr == MAP_FAILED) return nullptr;
+#ifdef MADV_HUGEPAGE
+    ::madvise(addr, length, MADV_HUGEPAGE);
+#endif
+    return addr;
+#endif
+}
+
+/// Release a buffer from alloc_large()
+inline void free_large(void* addr, std::size_t length) {
+    if (!addr) return;
+#ifdef _WIN32
+    (void)length;
+    VirtualFree(addr, 0, MEM_RELEASE);
+#else
+    ::munmap(addr, length);
+#endif
+}
+
+/// Append `length` bytes of src starting at `offset` to the end of dst.
+/// Uses copy_file_range on Linux (kernel-side copy, reflink on CoW filesystems),
+/// falling back to buffered reads elsewhere. Returns false on I/O error.
+inline bool copy_file_range(FileHandle& src, std::uint64_t offset, std::uint64_t length,
+                            std::FILE* dst) {
+    if (!src.valid() || !dst) return false;
+    if (std::fflush(dst) != 0) return false;
+
+#if defined(__linux__)
+    int out_fd = ::fileno(dst);
+    loff_t in_off = static_cast<loff_t>(offset);
+    while (length > 0) {
+        ssize_t n = ::copy_file_range(src.fd, &in_off, out_fd, nullptr,
+                                      static_cast<std::size_t>(length), 0);
+        if (n <= 0) break;  // Unsupported (e.g. EXDEV) or error: use buffered path
+        length -= static_cast<std::uint64_t>(n);
+    }
+    offset = static_cast<std::uint64_t>(in_off);
+    // Resync the stdio position with the descriptor we wrote behind its back
+    if (std::fseek(dst, 0, SEEK_END) != 0) return false;
+    if (length == 0) return true;
+#endif
+
+    std::vector<char> buf(std::size_t(1) << 20);
+    while (length > 0) {
+        std::size_t chunk = static_cast<std::size_t>(std::min<std::uint64_t>(length, buf.size()));
+#ifdef _WIN32
+        OVERLAPPED ov{};
+        ov.Offset = static_cast<DWORD>(offset & 0xFFFFFFFF);
+        ov.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        DWORD got = 0;
+        if (!ReadFile(src.file, buf.data(), static_cast<DWORD>(chunk), &got, &ov) || got == 0) {
+            return false;
+        }
+        std::size_t n = got;
+#else
+        ssize_t r = ::pread(src.fd, buf.data(), chunk, static_cast<off_t>(offset));
+        if (r <= 0) return false;
+        std::size_t n = static_cast<std::size_t>(r);
+#endif
+        if (std::fwrite(buf.data(), 1, n, dst) != n) return false;
+        offset += n;
+        length -= n;
+    }
+    return true;
+}
+
+/// Child process started by spawn_process()
+struct Process {
+#ifdef _WIN32
+    HANDLE handle = nullptr;
+#else
+    pid_t pid = -1;
+#endif
+
+    bool valid() const {
+#ifdef _WIN32
+        return handle != nullptr;
+#else
+        return pid > 0;
+#endif
+    }
+};
+
+/// Start args[0] (looked up in PATH) with the remaining arguments (UTF-8),
+/// sharing this process's console. Check valid() for failure to start.
+inline Process spawn_process(const std::vector<std::string>& args) {
+    Process p;
+    if (args.empty()) return p;
+#ifdef _WIN32
+    // Quote every argument following the CommandLineToArgvW rules
+    std::wstring cmdline;
+    for (const auto& arg : args) {
+        std::wstring w = fs::u8path(arg).wstring();
+        if (!cmdline.empty()) cmdline += L' ';
+        cmdline += L'"';
+        std::size_t slashes = 0;
+        for (wchar_t c : w) {
+            if (c == L'\\') {
+                ++slashes;
+            } else {
+                if (c == L'"') cmdline.append(slashes + 1, L'\\');
+                slashes = 0;
+            }
+            cmdline += c;
+        }
+        cmdline.append(slashes, L'\\');
+        cmdline += L'"';
+    }
+    STARTUPINFOW si{};
+    si.cb = sizeof(si);
+    PROCESS_INFORMATION pi{};
+    if (CreateProcessW(nullptr, cmdline.data(), nullptr, nullptr, FALSE, 0, nullptr, nullptr, &si, &pi)) {
+        CloseHandle(pi.hThread);
+        p.handle = pi.hProcess;
+    }
+#else
+    std::vector<char*> argv;
+    for (const auto& arg : args) argv.push_back(const_cast<char*>(arg.c_str()));
+    argv.push_back(nullptr);
+    pid_t pid;
+    if (::posix_spawnp(&pid, argv[0], nullptr, nullptr, argv.data(), environ) == 0) {
+        p.pid = pid;
+    }
+#endif
+    return p;
+}
+
+/// Wait for a process from spawn_process() to exit. Returns its exit code,
+/// or -1 if it was killed or could not be waited on.
+inline int wait_process(Process& p) {
+    if (!p.valid()) return -1;
+#ifdef _WIN32
+    DWORD code = static_cast<DWORD>(-1);
+    WaitForSingleObject(p.handle, INFINITE);
+    if (!GetExitCodeProcess(p.handle, &code)) code = static_cast<DWORD>(-1);
+    CloseHandle(p.handle);
+    p.handle = nullptr;
+    return static_cast<int>(code);
+#else
+    int status = 0;
+    pid_t r;
+    do {
+        r = ::waitpid(p.pid, &status, 0);
+    } while (r < 0 && errno == EINTR);
+    p.pid = -1;
+    if (r < 0 || !WIFEXITED(status)) return -1;
+    return WEXITSTATUS(status);
+#endif
+}
+
 /// Open output file stream (takes fs::path only, preventing accidental std::string overload)
 inline std::ofstream ofstream_open(const fs::path& path,
                                    std::ios::openmode mode = std::ios::binary) {
@@ -0,0 +1,79 @@
+#ifndef PLY2LCC_QUANTILE_SKETCH_HPP
+#define PLY2LCC_QUANTILE_SKETCH_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+namespace ply2lcc {
+
+/// Streaming quantile sketch over floats with ~3% relative bucket width.
+/// Buckets are the sign, exponent and top 5 mantissa bits of the IEEE value,
+/// so adding is a shift and sketches of any range merge by adding counts
+/// (one per thread, merged like AttributeRanges). Non-finite values are ignored.
+class QuantileSketch {
+public:
+    void add(float v) {
+        if (!std::isfinite(v)) return;
+        if (m_counts.empty()) m_counts.assign(NUM_BUCKETS, 0);
+        m_counts[bucket(v)]++;
+        m_total++;
+    }
+
+    void merge(const QuantileSketch& other) {
+        if (other.m_total == 0) return;
+        if (m_counts.empty()) m_counts.assign(NUM_BUCKETS, 0);
+        for (size_t i = 0; i < NUM_BUCKETS; ++i) m_counts[i] += other.m_counts[i];
+        m_total += other.m_total;
+    }
+
+    uint64_t count() const { return m_total; }
+
+    /// Range that leaves out at most `tail` of the values on each side,
+    /// rounded outward to bucket edges. Requires count() > 0.
+    std::pair<float, float> range(double tail) const {
+        const double skip = tail * static_cast<double>(m_total);
+        size_t lo = 0, hi = NUM_BUCKETS - 1;
+        uint64_t below = 0, above = 0;
+        while (static_cast<double>(below += m_counts[lo]) <= skip) ++lo;
+        while (static_cast<double>(above += m_counts[hi]) <= skip) --hi;
+        return {lower_edge(lo), upper_edge(hi)};
+    }
+
+private:
+    static constexpr int SHIFT = 18;  // Keeps sign + 8 exponent + 5 mantissa bits
+    static constexpr size_t HALF = size_t(1) << (31 - SHIFT);
+    static constexpr size_t NUM_BUCKETS = 2 * HALF;
+
+    // Buckets in value order: negatives by decreasing magnitude, then positives
+    static size_t bucket(float v) {
+        uint32_t bits;
+        std::memcpy(&bits, &v, 4);
+        size_t mag = (bits & 0x7fffffffu) >> SHIFT;
+        return (bits >> 31) ? HALF - 1 - mag : HALF + mag;
+    }
+
+    static float magnitude(size_t mag) {
+        uint32_t bits = static_cast<uint32_t>(mag) << SHIFT;
+        float v;
+        std::memcpy(&v, &bits, 4);
+        return v;
+    }
+
+    static float lower_edge(size_t b) {
+        return b >= HALF ? magnitude(b - HALF) : -magnitude(HALF - b);
+    }
+
+    static float upper_edge(size_t b) {
+        return b >= HALF ? magnitude(b - HALF + 1) : -magnitude(HALF - 1 - b);
+    }
+
+    std::vector<uint64_t> m_counts;  // Allocated on first use
+    uint64_t m_total = 0;
+};
+
+} // namespace ply2lcc
+
+#endif // PLY2LCC_QUANTILE_SKETCH_HPP
@@ -0,0 +1,123 @@
+#include "rate_control.hpp"
+#include "splat_buffer.hpp"
+#include "splat_order.hpp"
+#include <omp.h>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace ply2lcc {
+
+size_t count_grid_splats(const SpatialGrid& grid) {
+    size_t total = 0;
+    for (const auto& [id, cell] : grid.cells()) {
+        for (const auto& indices : cell.splat_indices) {
+            total += indices.size();
+        }
+    }
+    return total;
+}
+
+// Drop all but the `keep` most important rows of a cell; ties keep the earlier row
+static void keep_most_important(const SplatBuffer& splats, std::vector<size_t>& indices, size_t keep,
+                                std::vector<float>& scores, std::vector<uint32_t>& order) {
+    const size_t n = indices.size();
+    scores.resize(n);
+    order.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        scores[i] = splat_importance(splats[indices[i]]);
+        order[i] = static_cast<uint32_t>(i);
+    }
+
+    auto more_important = [&scores](uint32_t a, uint32_t b) {
+        return scores[a] != scores[b] ? scores[a] > scores[b] : a < b;
+    };
+    std::nth_element(order.begin(), order.begin() + static_cast<ptrdiff_t>(keep), order.end(), more_important);
+
+    // Reuse scores as the keep mask, then compact in place preserving order
+    std::fill(scores.begin(), scores.end(), 0.0f);
+    for (size_t i = 0; i < keep; ++i) scores[order[i]] = 1.0f;
+
+    size_t out = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (scores[i] != 0.0f) indices[out++] = indices[i];
+    }
+    indices.resize(out);
+}
+
+size_t prune_to_budget(SpatialGrid& grid,
+                       const std::vector<std::filesystem::path>& lod_files,
+                       size_t max_splats) {
+    const size_t total = count_grid_splats(grid);
+    if (total <= max_splats) return total;
+
+    const double fraction = static_cast<double>(max_splats) / static_cast<double>(total);
+    size_t kept_total = 0;
+
+    for (size_t lod = 0; lod < grid.num_lods(); ++lod) {
+        std::vector<std::vector<size_t>*> cells;
+        size_t lod_total = 0;
+        for (auto& [id, cell] : grid.cells()) {
+            auto& indices = cell.splat_indices[lod];
+            if (indices.empty()) continue;
+            cells.push_back(&indices);
+            lod_total += indices.size();
+        }
+
+        // Per-cell quotas: floor of the uniform share, then hand the LOD's
+        // remaining budget to the cells with the largest fractional parts
+        const auto lod_target = static_cast<size_t>(fraction * static_cast<double>(lod_total));
+        std::vector<size_t> quota(cells.size());
+        std::vector<std::pair<double, size_t>> remainders(cells.size());
+        size_t assigned = 0;
+        for (size_t c = 0; c < cells.size(); ++c) {
+            double share = fraction * static_cast<double>(cells[c]->size());
+            quota[c] = static_cast<size_t>(share);
+            remainders[c] = {share - std::floor(share), c};
+            assigned += quota[c];
+        }
+        size_t leftover = lod_target > assigned ? lod_target - assigned : 0;
+        if (leftover > 0) {
+            std::partial_sort(remainders.begin(), remainders.begin() + static_cast<ptrdiff_t>(leftover),
+                              remainders.end(), [](const auto& a, const auto& b) {
+                                  return a.first != b.first ? a.first > b.first : a.second < b.second;
+                              });
+            for (size_t i = 0; i < leftover; ++i) quota[remainders[i].second]++;
+        }
+
+        SplatBuffer splats;
+        if (!splats.initialize(lod_files[lod])) {
+            throw std::runtime_error("Failed to read " + lod_files[lod].u8string() + ": " + splats.error());
+        }
+
+        const auto cell_count = static_cast<ptrdiff_t>(cells.size());
+
+        #pragma omp parallel
+        {
+            std::vector<float> scores;
+            std::vector<uint32_t> order;
+
+            #pragma omp for schedule(dynamic)
+            for (ptrdiff_t c = 0; c < cell_count; ++c) {
+                auto& indices = *cells[static_cast<size_t>(c)];
+                size_t keep = quota[static_cast<size_t>(c)];
+                if (keep < indices.size()) {
+                    keep_most_important(splats, indices, keep, scores, order);
+                }
+            }
+        }
+
+        for (size_t q : quota) kept_total += q;
+    }
+
+    // Cells left without splats in every LOD are dropped from the index
+    for (auto it = grid.cells().begin(); it != grid.cells().end();) {
+        const auto& lods = it->second.splat_indices;
+        bool empty = std::all_of(lods.begin(), lods.end(), [](const auto& v) { return v.empty(); });
+        it = empty ? grid.cells().erase(it) : std::next(it);
+    }
+
+    return kept_total;
+}
+
+} // namespace ply2lcc
@@ -0,0 +1,31 @@
+#ifndef PLY2LCC_RATE_CONTROL_HPP
+#define PLY2LCC_RATE_CONTROL_HPP
+
+#include "types.hpp"
+#include "spatial_grid.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <filesystem>
+
+namespace ply2lcc {
+
+// Bytes a splat costs in data.bin, plus shcoef.bin when the output has SH
+inline size_t output_bytes_per_splat(bool has_sh) {
+    return has_sh ? 96 : 32;
+}
+
+// Splats across all LODs and cells of the grid
+size_t count_grid_splats(const SpatialGrid& grid);
+
+// Keep only the most important splats (by splat_importance) so the grid holds
+// at most max_splats splats across all LODs. Every cell keeps the same fraction
+// of its splats, with per-LOD largest-remainder rounding, so coverage stays
+// uniform. Kept splats stay in their existing order. Returns the new total.
+size_t prune_to_budget(SpatialGrid& grid,
+                       const std::vector<std::filesystem::path>& lod_files,
+                       size_t max_splats);
+
+} // namespace ply2lcc
+
+#endif // PLY2LCC_RATE_CONTROL_HPP
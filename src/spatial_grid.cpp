@@ -1,8 +1,10 @@
 #include "spatial_grid.hpp"
 #include "splat_buffer.hpp"
+#include "platform.hpp"
 #include <cmath>
 #include <algorithm>
 #include <stdexcept>
+#include <cstring>
 #include <omp.h>
 
 namespace ply2lcc {
@@ -11,20 +13,390 @@ SpatialGrid::SpatialGrid(float cell_size_x, float cell_size_y, size_t num_lods)
     : cell_size_x_(cell_size_x)
     , cell_size_y_(cell_size_y)
     , num_lods_(num_lods)
+    , prune_stats_(num_lods)
 {
 }
 
+// Why a splat is dropped by SplatFilter (first failing test), or Keep
+enum class PruneReason { Keep, NonFinite, Opacity, Scale };
+
+static PruneReason prune_reason(const SplatView& sv, const SplatFilter& filter) {
+    if (filter.drop_non_finite) {
+        bool finite = std::isfinite(sv.opacity());
+        for (int a = 0; a < 3; ++a) {
+            finite = finite && std::isfinite(sv.pos()[a]) && std::isfinite(sv.scale()[a]) &&
+                     std::isfinite(sv.f_dc()[a]);
+        }
+        for (int a = 0; a < 4; ++a) {
+            finite = finite && std::isfinite(sv.rot()[a]);
+        }
+        for (int i = 0; i < sv.num_f_rest(); ++i) {
+            finite = finite && std::isfinite(sv.f_rest(i));
+        }
+        if (!finite) return PruneReason::NonFinite;
+    }
+    if (filter.min_opacity > 0.0f && sigmoid(sv.opacity()) < filter.min_opacity) {
+        return PruneReason::Opacity;
+    }
+    if (filter.min_scale > 0.0f) {
+        float max_log_scale = std::max(sv.scale().x, std::max(sv.scale().y, sv.scale().z));
+        if (std::exp(max_log_scale) < filter.min_scale) return PruneReason::Scale;
+    }
+    return PruneReason::Keep;
+}
+
+// True if `pos` lies outside the core sphere of an EnvironmentSplit (radius 0 = no core)
+static bool outside_core(const EnvironmentSplit& env, const Vec3f& pos) {
+    if (env.radius <= 0.0f) return false;
+    float dx = pos.x - env.center.x, dy = pos.y - env.center.y, dz = pos.z - env.center.z;
+    return dx * dx + dy * dy + dz * dz > env.radius * env.radius;
+}
+
+using PositionSketch = std::array<QuantileSketch, 3>;
+
+// Rows per block of the crop pre-pass: blocks without a splat in the region are
+// not read again, so a small extract costs one sweep of the input positions
+constexpr size_t CROP_BLOCK_ROWS = 4096;
+
+// Bbox of the kept splats and the count of all rows with a non-finite position
+// (as SplatBuffer::compute_stats); also sketches kept positions if `positions`
+// is set, and flags the CROP_BLOCK_ROWS blocks holding a splat inside `region`
+// if `region_blocks` is set
+static SplatStats compute_filtered_stats(const SplatBuffer& splats, const SplatFilter& filter,
+                                         const EnvironmentSplit& env, const Region& region,
+                                         PositionSketch* positions, std::vector<uint8_t>* region_blocks) {
+    int n_threads = omp_get_max_threads();
+    std::vector<SplatStats> local(n_threads);
+    std::vector<PositionSketch> local_positions(positions ? n_threads : 0);
+    std::vector<std::vector<size_t>> local_blocks(region_blocks ? n_threads : 0);
+    const auto splat_count = static_cast<ptrdiff_t>(splats.size());
+
+    #pragma omp parallel
+    {
+        int tid = omp_get_thread_num();
+
+        #pragma omp for schedule(static)
+        for (ptrdiff_t i = 0; i < splat_count; ++i) {
+            SplatView sv = splats[static_cast<size_t>(i)];
+            const Vec3f pos = sv.pos();
+            if (!(std::isfinite(pos.x) && std::isfinite(pos.y) && std::isfinite(pos.z))) {
+                local[tid].non_finite++;
+                continue;
+            }
+            if (!region.contains(pos)) continue;
+            if (region_blocks) {
+                // Rows are ascending per thread, so each block is recorded once per thread
+                const size_t block = static_cast<size_t>(i) / CROP_BLOCK_ROWS;
+                if (local_blocks[tid].empty() || local_blocks[tid].back() != block) {
+                    local_blocks[tid].push_back(block);
+                }
+            }
+            if (prune_reason(sv, filter) == PruneReason::Keep && !outside_core(env, pos)) {
+                local[tid].bbox.expand(pos);
+                if (positions) {
+                    for (int a = 0; a < 3; ++a) local_positions[tid][a].add(pos[a]);
+                }
+            }
+        }
+    }
+
+    SplatStats stats;
+    for (const auto& s : local) {
+        stats.bbox.expand(s.bbox);
+        stats.non_finite += s.non_finite;
+    }
+    for (const auto& p : local_positions) {
+        for (int a = 0; a < 3; ++a) (*positions)[a].merge(p[a]);
+    }
+    if (region_blocks) {
+        region_blocks->assign((splats.size() + CROP_BLOCK_ROWS - 1) / CROP_BLOCK_ROWS, 0);
+        for (const auto& blocks : local_blocks) {
+            for (size_t block : blocks) (*region_blocks)[block] = 1;
+        }
+    }
+    return stats;
+}
+
+// Narrow `bbox` to leave out `tail` of the positions on each side of every axis
+static void clip_bbox(BBox& bbox, const PositionSketch& positions, double tail) {
+    for (int a = 0; a < 3; ++a) {
+        if (positions[a].count() == 0) continue;
+        auto [lo, hi] = positions[a].range(tail);
+        bbox.min[a] = std::max(bbox.min[a], lo);
+        bbox.max[a] = std::min(bbox.max[a], hi);
+    }
+}
+
+// Core sphere of LOD0: per-axis median center, radius = factor x 90th-percentile
+// distance, both estimated on an evenly strided sample of the kept splats
+static void estimate_core(const SplatBuffer& splats, const SplatFilter& filter, const Region& region,
+                          const EnvSeparation& env, EnvironmentSplit& split) {
+    const size_t stride = std::max<size_t>(1, splats.size() / std::max<size_t>(1, env.sample_size));
+    std::vector<Vec3f> sample;
+    sample.reserve(splats.size() / stride + 1);
+    for (size_t i = 0; i < splats.size(); i += stride) {
+        SplatView sv = splats[i];
+        if (region.contains(sv.pos()) && prune_reason(sv, filter) == PruneReason::Keep) {
+            sample.push_back(sv.pos());
+        }
+    }
+    if (sample.empty()) return;
+
+    std::vector<float> values(sample.size());
+    const size_t mid = values.size() / 2;
+    for (int a = 0; a < 3; ++a) {
+        for (size_t i = 0; i < sample.size(); ++i) values[i] = sample[i][a];
+        std::nth_element(values.begin(), values.begin() + static_cast<ptrdiff_t>(mid), values.end());
+        split.center[a] = values[mid];
+    }
+
+    for (size_t i = 0; i < sample.size(); ++i) {
+        float dx = sample[i].x - split.center.x;
+        float dy = sample[i].y - split.center.y;
+        float dz = sample[i].z - split.center.z;
+        values[i] = std::sqrt(dx * dx + dy * dy + dz * dz);
+    }
+    const size_t p90 = std::min(values.size() - 1, values.size() * 9 / 10);
+    std::nth_element(values.begin(), values.begin() + static_cast<ptrdiff_t>(p90), values.end());
+    // A degenerate core (all sampled splats at one point) keeps everything
+    split.radius = values[p90] > 0.0f ? env.radius_factor * values[p90] : 0.0f;
+}
+
+// Cell coordinate along one axis: clamp into [lo, hi] (NaN goes to lo), scale
+// by the reciprocal cell size and truncate; branch-free so it vectorises
+static inline int32_t cell_coord(float v, float lo, float hi, float inv_size) {
+    v = v > lo ? v : lo;
+    v = v < hi ? v : hi;
+    float c = (v - lo) * inv_size;
+    c = c < 65535.0f ? c : 65535.0f;
+    return static_cast<int32_t>(c);  // c >= 0, so truncation is floor
+}
+
+uint32_t SpatialGrid::compute_cell_index(const Vec3f& pos) const {
+    // Outliers beyond a clipped bbox land in the edge cells
+    const auto cell_x = cell_coord(pos.x, bbox_.min.x, bbox_.max.x, 1.0f / cell_size_x_);
+    const auto cell_y = cell_coord(pos.y, bbox_.min.y, bbox_.max.y, 1.0f / cell_size_y_);
+    return (static_cast<uint32_t>(cell_y) << 16) | static_cast<uint32_t>(cell_x);
+}
+
+void SpatialGrid::compute_cell_indices(const float* xs, const float* ys, size_t n, uint32_t* out) const {
+    const float min_x = bbox_.min.x, max_x = bbox_.max.x, inv_x = 1.0f / cell_size_x_;
+    const float min_y = bbox_.min.y, max_y = bbox_.max.y, inv_y = 1.0f / cell_size_y_;
+
+    #pragma omp simd
+    for (size_t i = 0; i < n; ++i) {
+        const auto cell_x = cell_coord(xs[i], min_x, max_x, inv_x);
+        const auto cell_y = cell_coord(ys[i], min_y, max_y, inv_y);
+        out[i] = (static_cast<uint32_t>(cell_y) << 16) | static_cast<uint32_t>(cell_x);
+    }
+}
+
+namespace {
+
+// Per-thread binning and range pass. Kept rows are buffered in blocks of
+// per-attribute arrays; each full block yields its cell ids and every range
+// min/max (plus SH energy) from vector loops, and finish() buckets the cell ids
+// with a radix sort instead of a std::map lookup per splat. exp() and sigmoid()
+// are monotonic, so scale and opacity extremes are tracked in log/logit space
+// and converted once in finish()
+class BlockBinner {
+public:
+    BlockBinner(const SpatialGrid& grid, ThreadLocalGrid& local, int bands_per_channel, bool sketching)
+        : m_grid(grid), m_local(local), m_bands(bands_per_channel), m_sketching(sketching),
+          m_sh(static_cast<size_t>(3 * bands_per_channel) * BLOCK) {}
+
+    void add(size_t row, const SplatView& sv) {
+        const Vec3f pos = sv.pos();
+        m_xs[m_fill] = pos.x;
+        m_ys[m_fill] = pos.y;
+        const Vec3f& log_scale = sv.scale();
+        for (int a = 0; a < 3; ++a) m_log_scale[a][m_fill] = log_scale[a];
+        m_opacity[m_fill] = sv.opacity();
+        if (m_bands > 0) {
+            const Vec3f& dc = sv.f_dc();
+            for (int a = 0; a < 3; ++a) m_dc[a][m_fill] = dc[a];
+            float scratch[MAX_F_REST];
+            const float* f_rest = sv.sh_rest(scratch);
+            for (int c = 0; c < 3 * m_bands; ++c) m_sh[static_cast<size_t>(c) * BLOCK + m_fill] = f_rest[c];
+        }
+        m_block_rows[m_fill] = static_cast<uint64_t>(row);
+        if (++m_fill == BLOCK) flush();
+    }
+
+    // Hand the binned rows (ascending within each cell) and ranges to the local grid
+    void finish() {
+        flush();
+        sort_by_cell();
+        m_local.cell_ids = std::move(m_ids);
+        m_local.rows = std::move(m_rows);
+
+        if (m_opacity_min > m_opacity_max) return;  // Nothing added
+        for (const Vec3f& log_scale : {m_log_scale_range.min, m_log_scale_range.max}) {
+            m_local.ranges.expand_scale(Vec3f(std::exp(log_scale.x), std::exp(log_scale.y), std::exp(log_scale.z)));
+        }
+        m_local.ranges.expand_opacity(sigmoid(m_opacity_min));
+        m_local.ranges.expand_opacity(sigmoid(m_opacity_max));
+    }
+
+private:
+    static constexpr size_t BLOCK = 1024;
+
+    // Same comparisons as std::min/std::max, so a NaN never replaces a bound
+    static void reduce_range(const float* v, size_t n, float& lo, float& hi) {
+        float l = lo, h = hi;
+        #pragma omp simd reduction(min : l) reduction(max : h)
+        for (size_t k = 0; k < n; ++k) {
+            l = v[k] < l ? v[k] : l;
+            h = h < v[k] ? v[k] : h;
+        }
+        lo = l;
+        hi = h;
+    }
+
+    void flush() {
+        if (m_fill == 0) return;
+        const size_t n = m_fill;
+        const size_t base = m_ids.size();
+        m_ids.resize(base + n);
+        m_grid.compute_cell_indices(m_xs, m_ys, n, m_ids.data() + base);
+        m_rows.insert(m_rows.end(), m_block_rows, m_block_rows + n);
+
+        for (int a = 0; a < 3; ++a) {
+            reduce_range(m_log_scale[a], n, m_log_scale_range.min[a], m_log_scale_range.max[a]);
+        }
+        reduce_range(m_opacity, n, m_opacity_min, m_opacity_max);
+        if (m_sketching) {
+            for (int a = 0; a < 3; ++a) {
+                for (size_t k = 0; k < n; ++k) m_local.sketch.scale[a].add(std::exp(m_log_scale[a][k]));
+            }
+        }
+        if (m_bands > 0) flush_sh(n);
+        m_fill = 0;
+    }
+
+    // SH channel ranges and the opacity-weighted energy per degree
+    void flush_sh(size_t n) {
+        ShEnergy& energy = m_local.sh_energy;
+        float alpha[BLOCK];
+        for (size_t k = 0; k < n; ++k) alpha[k] = sigmoid(m_opacity[k]);
+
+        double weight = 0.0, dc_sq = 0.0;
+        #pragma omp simd reduction(+ : weight, dc_sq)
+        for (size_t k = 0; k < n; ++k) {
+            weight += alpha[k];
+            dc_sq += alpha[k] * (static_cast<double>(m_dc[0][k]) * m_dc[0][k] +
+                                 static_cast<double>(m_dc[1][k]) * m_dc[1][k] +
+                                 static_cast<double>(m_dc[2][k]) * m_dc[2][k]);
+        }
+        energy.weight += weight;
+        energy.dc_sq += dc_sq;
+
+        for (int band = 0; band < m_bands; ++band) {
+            const float* r = &m_sh[static_cast<size_t>(band) * BLOCK];
+            const float* g = &m_sh[static_cast<size_t>(band + m_bands) * BLOCK];
+            const float* b = &m_sh[static_cast<size_t>(band + 2 * m_bands) * BLOCK];
+            reduce_range(r, n, m_local.ranges.sh_min.x, m_local.ranges.sh_max.x);
+            reduce_range(g, n, m_local.ranges.sh_min.y, m_local.ranges.sh_max.y);
+            reduce_range(b, n, m_local.ranges.sh_min.z, m_local.ranges.sh_max.z);
+
+            double band_sq = 0.0;
+            #pragma omp simd reduction(+ : band_sq)
+            for (size_t k = 0; k < n; ++k) {
+                band_sq += alpha[k] * (static_cast<double>(r[k]) * r[k] + static_cast<double>(g[k]) * g[k] +
+                                       static_cast<double>(b[k]) * b[k]);
+            }
+            // Coefficients l^2 - 1 .. (l + 1)^2 - 2 belong to degree l
+            energy.band_sq[band < 3 ? 0 : (band < 8 ? 1 : 2)] += band_sq;
+
+            if (m_sketching) {
+                for (size_t k = 0; k < n; ++k) {
+                    m_local.sketch.sh[0].add(r[k]);
+                    m_local.sketch.sh[1].add(g[k]);
+                    m_local.sketch.sh[2].add(b[k]);
+                }
+            }
+        }
+    }
+
+    // Stable LSD radix sort by cell id, one pass per 16-bit coordinate
+    void sort_by_cell() {
+        std::vector<uint32_t> ids(m_ids.size());
+        std::vector<uint64_t> rows(m_rows.size());
+        std::vector<size_t> offsets;
+        for (int shift = 0; shift < 32; shift += 16) {
+            uint32_t max_digit = 0;
+            for (uint32_t id : m_ids) max_digit = std::max(max_digit, (id >> shift) & 0xFFFFu);
+            if (max_digit == 0) continue;
+
+            offsets.assign(max_digit + 2, 0);
+            for (uint32_t id : m_ids) offsets[((id >> shift) & 0xFFFFu) + 1]++;
+            for (size_t d = 1; d < offsets.size(); ++d) offsets[d] += offsets[d - 1];
+            for (size_t i = 0; i < m_ids.size(); ++i) {
+                size_t pos = offsets[(m_ids[i] >> shift) & 0xFFFFu]++;
+                ids[pos] = m_ids[i];
+                rows[pos] = m_rows[i];
+            }
+            m_ids.swap(ids);
+            m_rows.swap(rows);
+        }
+    }
+
+    const SpatialGrid& m_grid;
+    ThreadLocalGrid& m_local;
+    int m_bands;
+    bool m_sketching;
+
+    float m_xs[BLOCK];
+    float m_ys[BLOCK];
+    float m_log_scale[3][BLOCK];
+    float m_opacity[BLOCK];
+    float m_dc[3][BLOCK];
+    std::vector<float> m_sh;  // 3 x bands columns of BLOCK values, in f_rest order
+    uint64_t m_block_rows[BLOCK];
+    size_t m_fill = 0;
+
+    std::vector<uint32_t> m_ids;
+    std::vector<uint64_t> m_rows;  // Sharded LODs can pass 2^32 rows in total
+    BBox m_log_scale_range;
+    float m_opacity_min = std::numeric_limits<float>::max();
+    float m_opacity_max = std::numeric_limits<float>::lowest();
+};
+
+} // namespace
+
 SpatialGrid SpatialGrid::from_files(const std::vector<std::filesystem::path>& lod_files,
-                                     float cell_size_x, float cell_size_y) {
+                                     float cell_size_x, float cell_size_y,
+                                     const SplatFilter& filter,
+                                     const EnvSeparation& env,
+                                     const RobustRanges& robust,
+                                     const Region& region,
+                                     const SplatTransform& transform) {
     SpatialGrid grid(cell_size_x, cell_size_y, lod_files.size());
+    const bool filtering = filter.enabled();
+    const bool cropping = region.enabled();
+    EnvironmentSplit& split = grid.environment_;
+    grid.robust_ = robust;
+    grid.transform_ = transform;
+    PositionSketch positions;
+    std::vector<std::vector<uint8_t>> region_blocks(lod_files.size());  // Set when cropping
 
-    // First pass: compute global bbox (needed for grid cell calculation)
+    // First pass: compute global bbox (needed for grid cell calculation).
+    // The core sphere comes from LOD0 and bounds every LOD.
     for (size_t lod = 0; lod < lod_files.size(); ++lod) {
         SplatBuffer buffer;
-        if (!buffer.initialize(lod_files[lod])) {
+        if (!buffer.initialize(lod_files[lod], &grid.transform_)) {
             throw std::runtime_error("Failed to read " + lod_files[lod].u8string() + ": " + buffer.error());
         }
-        grid.bbox_.expand(buffer.compute_bbox());
+        if (lod == 0 && env.enabled()) {
+            estimate_core(buffer, filter, region, env, split);
+        }
+        const bool separating = split.radius > 0.0f;
+        const SplatStats stats = filtering || separating || cropping || robust.clips_bbox()
+            ? compute_filtered_stats(buffer, filter, split, region, robust.clips_bbox() ? &positions : nullptr,
+                                     cropping ? &region_blocks[lod] : nullptr)
+            : buffer.compute_stats();
+        grid.bbox_.expand(stats.bbox);
+        grid.non_finite_positions_ += stats.non_finite;
 
         if (lod == 0) {
             grid.has_sh_ = buffer.num_f_rest() > 0;
@@ -32,78 +404,522 @@ SpatialGrid SpatialGrid::from_files(const std::vector<std::filesystem::path>& lo
             grid.num_f_rest_ = buffer.num_f_rest();
         }
     }
+    if (robust.clips_bbox()) {
+        clip_bbox(grid.bbox_, positions, RobustRanges::tail(robust.bbox_percentile));
+    }
 
     // Second pass: parallel grid building per LOD
     int n_threads = omp_get_max_threads();
     int bands_per_channel = (grid.has_sh_ && grid.num_f_rest_ > 0) ? grid.num_f_rest_ / 3 : 0;
+    const bool sketching = robust.clips_ranges();
+    RangeSketch sketch;
 
     for (size_t lod = 0; lod < lod_files.size(); ++lod) {
         SplatBuffer splats;
-        if (!splats.initialize(lod_files[lod])) {
+        if (!splats.initialize(lod_files[lod], &grid.transform_)) {
             throw std::runtime_error("Failed to read " + lod_files[lod].u8string() + ": " + splats.error());
         }
 
         std::vector<ThreadLocalGrid> local_grids(n_threads);
+        std::vector<PruneStats> local_pruned(n_threads);
+        std::vector<std::vector<size_t>> local_far(n_threads);
+        const std::vector<uint8_t>& blocks = region_blocks[lod];
 
         #pragma omp parallel
         {
             int tid = omp_get_thread_num();
             const auto splat_count = static_cast<ptrdiff_t>(splats.size());
+            BlockBinner binner(grid, local_grids[tid], bands_per_channel, sketching);
 
-            #pragma omp for schedule(static)
+            #pragma omp for schedule(static) nowait
             for (ptrdiff_t i = 0; i < splat_count; ++i) {
+                if (cropping && !blocks[static_cast<size_t>(i) / CROP_BLOCK_ROWS]) continue;
                 SplatView sv = splats[static_cast<size_t>(i)];
-                uint32_t cell_id = grid.compute_cell_index(sv.pos());
-
-                local_grids[tid].cell_indices[cell_id].push_back(static_cast<size_t>(i));
-
-                // Expand ranges
-                Vec3f linear_scale(std::exp(sv.scale().x), std::exp(sv.scale().y), std::exp(sv.scale().z));
-                local_grids[tid].ranges.expand_scale(linear_scale);
-                local_grids[tid].ranges.expand_opacity(sigmoid(sv.opacity()));
-
-                if (bands_per_channel > 0) {
-                    for (int band = 0; band < bands_per_channel; ++band) {
-                        local_grids[tid].ranges.expand_sh(
-                            sv.f_rest(band),
-                            sv.f_rest(band + bands_per_channel),
-                            sv.f_rest(band + 2 * bands_per_channel));
+                if (cropping && !region.contains(sv.pos())) continue;
+                if (filtering) {
+                    PruneReason reason = prune_reason(sv, filter);
+                    if (reason != PruneReason::Keep) {
+                        PruneStats& pruned = local_pruned[tid];
+                        if (reason == PruneReason::NonFinite) pruned.non_finite++;
+                        else if (reason == PruneReason::Opacity) pruned.opacity++;
+                        else pruned.scale++;
+                        continue;
                     }
                 }
+                if (outside_core(split, sv.pos())) {
+                    local_far[tid].push_back(static_cast<size_t>(i));
+                    continue;
+                }
+                binner.add(static_cast<size_t>(i), sv);
             }
+            binner.finish();
         }
 
         // Sequential merge
+        grid.merge(local_grids, lod);
         for (int t = 0; t < n_threads; ++t) {
-            grid.merge(local_grids[t], lod);
             grid.ranges_.merge(local_grids[t].ranges);
+            grid.sh_energy_.merge(local_grids[t].sh_energy);
+            sketch.merge(local_grids[t].sketch);
+
+            PruneStats& pruned = grid.prune_stats_[lod];
+            pruned.non_finite += local_pruned[t].non_finite;
+            pruned.opacity += local_pruned[t].opacity;
+            pruned.scale += local_pruned[t].scale;
+
+            // Static schedule: thread t holds the t-th block of rows, so rows stay ascending
+            if (lod == 0) {
+                split.rows.insert(split.rows.end(), local_far[t].begin(), local_far[t].end());
+            } else {
+                split.dropped += local_far[t].size();
+            }
         }
     }
+    if (sketching) {
+        sketch.clip(grid.ranges_, RobustRanges::tail(robust.range_percentile));
+    }
 
     return grid;
 }
 
-uint32_t SpatialGrid::compute_cell_index(const Vec3f& pos) const {
-    int cell_x = static_cast<int>(std::floor((pos.x - bbox_.min.x) / cell_size_x_));
-    int cell_y = static_cast<int>(std::floor((pos.y - bbox_.min.y) / cell_size_y_));
+// One pass over the cells in id order: every local grid holds a run of rows per
+// cell, and runs are appended in local grid order so rows stay ascending
+void SpatialGrid::merge(const std::vector<ThreadLocalGrid>& locals, size_t lod) {
+    std::vector<size_t> pos(locals.size(), 0);
+    for (;;) {
+        uint32_t cell_id = UINT32_MAX;
+        bool any = false;
+        for (size_t t = 0; t < locals.size(); ++t) {
+            if (pos[t] < locals[t].cell_ids.size()) {
+                cell_id = any ? std::min(cell_id, locals[t].cell_ids[pos[t]]) : locals[t].cell_ids[pos[t]];
+                any = true;
+            }
+        }
+        if (!any) break;
 
-    // Clamp to valid range (16-bit each)
-    cell_x = std::max(0, std::min(cell_x, 65535));
-    cell_y = std::max(0, std::min(cell_y, 65535));
+        auto it = cells_.lower_bound(cell_id);
+        if (it == cells_.end() || it->first != cell_id) {
+            it = cells_.emplace_hint(it, cell_id, GridCell(cell_id, num_lods_));
+        }
+        auto& target = it->second.splat_indices[lod];
+        for (size_t t = 0; t < locals.size(); ++t) {
+            const auto& ids = locals[t].cell_ids;
+            size_t end = pos[t];
+            while (end < ids.size() && ids[end] == cell_id) ++end;
+            target.insert(target.end(), locals[t].rows.begin() + static_cast<ptrdiff_t>(pos[t]),
+                          locals[t].rows.begin() + static_cast<ptrdiff_t>(end));
+            pos[t] = end;
+        }
+    }
+}
 
-    return (static_cast<uint32_t>(cell_y) << 16) | static_cast<uint32_t>(cell_x);
+void SpatialGrid::append_lod(ThreadLocalGrid level) {
+    ++num_lods_;
+    prune_stats_.resize(num_lods_);
+    for (auto& [cell_id, cell] : cells_) {
+        cell.splat_indices.resize(num_lods_);
+    }
+    ranges_.merge(level.ranges);
+    std::vector<ThreadLocalGrid> locals;
+    locals.push_back(std::move(level));
+    merge(locals, num_lods_ - 1);
 }
 
-void SpatialGrid::merge(const ThreadLocalGrid& local, size_t lod) {
-    for (const auto& [cell_id, indices] : local.cell_indices) {
-        auto it = cells_.find(cell_id);
-        if (it == cells_.end()) {
-            auto result = cells_.emplace(cell_id, GridCell(cell_id, num_lods_));
-            it = result.first;
+void SpatialGrid::remove_rows(const std::vector<std::filesystem::path>& lod_files,
+                              const std::vector<std::vector<uint8_t>>& drop) {
+    // Rows that stay: indexed by some cell and not dropped
+    std::vector<std::vector<uint8_t>> keep(num_lods_);
+    for (size_t lod = 0; lod < num_lods_; ++lod) {
+        for (const auto& [cell_id, cell] : cells_) {
+            for (size_t row : cell.splat_indices[lod]) {
+                if (row >= keep[lod].size()) keep[lod].resize(row + 1, 0);
+                keep[lod][row] = (lod < drop.size() && row < drop[lod].size() && drop[lod][row]) ? 0 : 1;
+            }
         }
-        auto& target = it->second.splat_indices[lod];
-        target.insert(target.end(), indices.begin(), indices.end());
     }
+
+    std::vector<SplatBuffer> buffers(num_lods_);
+    BBox bbox;
+    PositionSketch positions;
+    for (size_t lod = 0; lod < num_lods_; ++lod) {
+        if (!buffers[lod].initialize(lod_files[lod], &transform_)) {
+            throw std::runtime_error("Failed to read " + lod_files[lod].u8string() + ": " + buffers[lod].error());
+        }
+        for (size_t row = 0; row < keep[lod].size(); ++row) {
+            if (!keep[lod][row]) continue;
+            const Vec3f& pos = buffers[lod][row].pos();
+            bbox.expand(pos);
+            if (robust_.clips_bbox()) {
+                for (int a = 0; a < 3; ++a) positions[a].add(pos[a]);
+            }
+        }
+    }
+    if (robust_.clips_bbox()) {
+        clip_bbox(bbox, positions, RobustRanges::tail(robust_.bbox_percentile));
+    }
+
+    // Re-bin from the tightened bbox; rows stay in input order within each cell
+    bbox_ = bbox;
+    ranges_ = AttributeRanges();
+    sh_energy_ = ShEnergy();
+    cells_.clear();
+
+    int n_threads = omp_get_max_threads();
+    int bands_per_channel = (has_sh_ && num_f_rest_ > 0) ? num_f_rest_ / 3 : 0;
+    const bool sketching = robust_.clips_ranges();
+    RangeSketch sketch;
+
+    for (size_t lod = 0; lod < num_lods_; ++lod) {
+        const SplatBuffer& splats = buffers[lod];
+        const auto& lod_keep = keep[lod];
+        std::vector<ThreadLocalGrid> local_grids(n_threads);
+
+        #pragma omp parallel
+        {
+            int tid = omp_get_thread_num();
+            const auto row_count = static_cast<ptrdiff_t>(lod_keep.size());
+            BlockBinner binner(*this, local_grids[tid], bands_per_channel, sketching);
+
+            #pragma omp for schedule(static) nowait
+            for (ptrdiff_t i = 0; i < row_count; ++i) {
+                if (!lod_keep[static_cast<size_t>(i)]) continue;
+                SplatView sv = splats[static_cast<size_t>(i)];
+                binner.add(static_cast<size_t>(i), sv);
+            }
+            binner.finish();
+        }
+
+        merge(local_grids, lod);
+        for (int t = 0; t < n_threads; ++t) {
+            ranges_.merge(local_grids[t].ranges);
+            sh_energy_.merge(local_grids[t].sh_energy);
+            sketch.merge(local_grids[t].sketch);
+        }
+    }
+    if (sketching) {
+        sketch.clip(ranges_, RobustRanges::tail(robust_.range_percentile));
+    }
+}
+
+SpatialGrid SpatialGrid::empty_copy() const {
+    SpatialGrid copy(cell_size_x_, cell_size_y_, num_lods_);
+    copy.bbox_ = bbox_;
+    copy.ranges_ = ranges_;
+    copy.sh_energy_ = sh_energy_;
+    copy.has_sh_ = has_sh_;
+    copy.sh_degree_ = sh_degree_;
+    copy.num_f_rest_ = num_f_rest_;
+    copy.prune_stats_ = prune_stats_;
+    copy.non_finite_positions_ = non_finite_positions_;
+    copy.environment_ = environment_;
+    copy.robust_ = robust_;
+    copy.transform_ = transform_;
+    return copy;
+}
+
+SpatialGrid SpatialGrid::subset(const std::vector<uint32_t>& cell_ids) const {
+    SpatialGrid copy = empty_copy();
+    for (uint32_t id : cell_ids) {
+        auto it = cells_.find(id);
+        if (it != cells_.end()) copy.cells_.emplace(id, it->second);
+    }
+    return copy;
+}
+
+std::vector<std::pair<int, SpatialGrid>> SpatialGrid::split_layers(
+        const std::vector<std::filesystem::path>& lod_files, float layer_height) const {
+    if (!(layer_height > 0.0f)) {
+        throw std::runtime_error("Layer height must be positive");
+    }
+
+    const float inv_h = 1.0f / layer_height;
+    std::map<int, SpatialGrid> layers;
+    auto layer_for = [&](int k) -> SpatialGrid& {
+        auto it = layers.find(k);
+        if (it != layers.end()) return it->second;
+        SpatialGrid layer = empty_copy();
+        // x/y extent stays so cell ids keep their meaning; z is rebuilt from the rows
+        layer.bbox_.min.z = std::numeric_limits<float>::max();
+        layer.bbox_.max.z = std::numeric_limits<float>::lowest();
+        return layers.emplace(k, std::move(layer)).first->second;
+    };
+
+    for (size_t lod = 0; lod < num_lods_; ++lod) {
+        SplatBuffer splats;
+        if (!splats.initialize(lod_files[lod], &transform_)) {
+            throw std::runtime_error("Failed to read " + lod_files[lod].u8string() + ": " + splats.error());
+        }
+        for (const auto& [cell_id, cell] : cells_) {
+            for (size_t row : cell.splat_indices[lod]) {
+                // Same clamping as the cell coordinates, so outliers join the end layers
+                float z = splats[row].pos().z;
+                z = z > bbox_.min.z ? z : bbox_.min.z;
+                z = z < bbox_.max.z ? z : bbox_.max.z;
+                const int k = cell_coord(z, bbox_.min.z, bbox_.max.z, inv_h);
+                SpatialGrid& layer = layer_for(k);
+                auto it = layer.cells_.try_emplace(cell_id, cell_id, num_lods_).first;
+                it->second.splat_indices[lod].push_back(row);
+                layer.bbox_.min.z = std::min(layer.bbox_.min.z, z);
+                layer.bbox_.max.z = std::max(layer.bbox_.max.z, z);
+            }
+        }
+    }
+
+    std::vector<std::pair<int, SpatialGrid>> result;
+    result.reserve(layers.size());
+    for (auto& [k, layer] : layers) result.emplace_back(k, std::move(layer));
+    return result;
+}
+
+// Grid cache format (little-endian):
+//   magic "P2LG", version, key_len, key bytes
+//   cell_size_x, cell_size_y, bbox (6 floats), ranges (14 floats), SH energy (5 doubles)
+//   num_lods, has_sh, sh_degree, num_f_rest, num_cells
+//   per cell: index, then per LOD: count + count x uint64 row indices
+//   environment: center (3 floats), radius, dropped, count + count x uint64 LOD0 rows
+//   range clipping: bbox and range percentiles (2 floats)
+//   transform: SplatTransform as stored in memory
+//   per LOD: pruned non-finite, opacity, scale (3 x uint64); unfiltered non-finite positions
+static constexpr uint32_t GRID_CACHE_MAGIC = 0x474c3250;  // "P2LG"
+static constexpr uint32_t GRID_CACHE_VERSION = 7;
+
+template <typename T>
+static void write_pod(std::ostream& out, const T& v) {
+    out.write(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+
+template <typename T>
+static bool read_pod(std::istream& in, T& v) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&v), sizeof(T)));
+}
+
+// Bytes left after the read position, so counts read from a corrupt file can be
+// rejected before anything is allocated for them
+static uint64_t bytes_left(std::istream& in, uint64_t file_size) {
+    const std::streamoff pos = in.tellg();
+    if (pos < 0 || static_cast<uint64_t>(pos) > file_size) return 0;
+    return file_size - static_cast<uint64_t>(pos);
+}
+
+std::string SpatialGrid::cache_key(const std::vector<std::filesystem::path>& lod_files,
+                                   float cell_size_x, float cell_size_y,
+                                   const SplatFilter& filter,
+                                   const EnvSeparation& env,
+                                   const RobustRanges& robust,
+                                   const Region& region,
+                                   const SplatTransform& transform) {
+    std::string key;
+    auto append = [&key](const void* p, size_t n) {
+        key.append(static_cast<const char*>(p), n);
+    };
+
+    append(&cell_size_x, sizeof(float));
+    append(&cell_size_y, sizeof(float));
+    append(&filter.min_opacity, sizeof(float));
+    append(&filter.min_scale, sizeof(float));
+    uint8_t drop_non_finite = filter.drop_non_finite ? 1 : 0;
+    append(&drop_non_finite, sizeof(drop_non_finite));
+    append(&env.radius_factor, sizeof(float));
+    uint64_t env_sample = env.sample_size;
+    append(&env_sample, sizeof(env_sample));
+    append(&robust.bbox_percentile, sizeof(float));
+    append(&robust.range_percentile, sizeof(float));
+    append(&region.min_x, sizeof(float));
+    append(&region.min_y, sizeof(float));
+    append(&region.max_x, sizeof(float));
+    append(&region.max_y, sizeof(float));
+    append(&region.min_z, sizeof(float));
+    append(&region.max_z, sizeof(float));
+    if (!region.polygon.empty()) {
+        append(region.polygon.data(), region.polygon.size() * sizeof(region.polygon[0]));
+    }
+    append(&transform.rotation, sizeof(transform.rotation));
+
+    // Every shard of every LOD, so rewriting any part invalidates the cache
+    std::vector<std::filesystem::path> inputs;
+    for (const auto& lod_path : lod_files) {
+        const auto parts = SplatBuffer::shard_paths(lod_path);
+        inputs.insert(inputs.end(), parts.begin(), parts.end());
+    }
+    for (const auto& path : inputs) {
+        std::error_code ec;
+        std::string abs_path = std::filesystem::absolute(path, ec).u8string();
+        uint64_t size = std::filesystem::file_size(path, ec);
+        int64_t mtime = static_cast<int64_t>(
+            std::filesystem::last_write_time(path, ec).time_since_epoch().count());
+
+        uint32_t len = static_cast<uint32_t>(abs_path.size());
+        append(&len, sizeof(len));
+        key += abs_path;
+        append(&size, sizeof(size));
+        append(&mtime, sizeof(mtime));
+    }
+    return key;
+}
+
+bool SpatialGrid::save(const std::filesystem::path& path, const std::string& key) const {
+    std::error_code ec;
+    if (path.has_parent_path()) {
+        std::filesystem::create_directories(path.parent_path(), ec);
+    }
+
+    // Write to a temporary file and rename, so an interrupted run never leaves
+    // a truncated cache that could match the key
+    std::filesystem::path tmp_path = path;
+    tmp_path += ".tmp";
+    {
+        auto out = platform::ofstream_open(tmp_path);
+        if (!out) return false;
+
+        write_pod(out, GRID_CACHE_MAGIC);
+        write_pod(out, GRID_CACHE_VERSION);
+        write_pod(out, static_cast<uint32_t>(key.size()));
+        out.write(key.data(), static_cast<std::streamsize>(key.size()));
+
+        write_pod(out, cell_size_x_);
+        write_pod(out, cell_size_y_);
+        write_pod(out, bbox_);
+        write_pod(out, ranges_);
+        write_pod(out, sh_energy_);
+        write_pod(out, static_cast<uint64_t>(num_lods_));
+        write_pod(out, static_cast<uint8_t>(has_sh_ ? 1 : 0));
+        write_pod(out, static_cast<int32_t>(sh_degree_));
+        write_pod(out, static_cast<int32_t>(num_f_rest_));
+        write_pod(out, static_cast<uint64_t>(cells_.size()));
+
+        std::vector<uint64_t> rows;  // Sharded LODs can pass 2^32 rows
+        for (const auto& [cell_id, cell] : cells_) {
+            write_pod(out, cell_id);
+            for (const auto& indices : cell.splat_indices) {
+                rows.assign(indices.begin(), indices.end());
+                write_pod(out, static_cast<uint64_t>(rows.size()));
+                out.write(reinterpret_cast<const char*>(rows.data()),
+                          static_cast<std::streamsize>(rows.size() * sizeof(uint64_t)));
+            }
+        }
+
+        write_pod(out, environment_.center);
+        write_pod(out, environment_.radius);
+        write_pod(out, static_cast<uint64_t>(environment_.dropped));
+        rows.assign(environment_.rows.begin(), environment_.rows.end());
+        write_pod(out, static_cast<uint64_t>(rows.size()));
+        out.write(reinterpret_cast<const char*>(rows.data()),
+                  static_cast<std::streamsize>(rows.size() * sizeof(uint64_t)));
+
+        write_pod(out, robust_.bbox_percentile);
+        write_pod(out, robust_.range_percentile);
+        write_pod(out, transform_);
+        for (const PruneStats& pruned : prune_stats_) {
+            write_pod(out, static_cast<uint64_t>(pruned.non_finite));
+            write_pod(out, static_cast<uint64_t>(pruned.opacity));
+            write_pod(out, static_cast<uint64_t>(pruned.scale));
+        }
+        write_pod(out, static_cast<uint64_t>(non_finite_positions_));
+
+        if (!out) return false;
+    }
+
+    std::filesystem::rename(tmp_path, path, ec);
+    if (ec) {
+        std::filesystem::remove(tmp_path, ec);
+        return false;
+    }
+    return true;
+}
+
+std::optional<SpatialGrid> SpatialGrid::load(const std::filesystem::path& path,
+                                             const std::string& key, size_t num_lods_expected) {
+    auto in = platform::ifstream_open(path);
+    if (!in) return std::nullopt;
+    std::error_code ec;
+    const uint64_t file_size = std::filesystem::file_size(path, ec);
+    if (ec) return std::nullopt;
+
+    uint32_t magic = 0, version = 0, key_len = 0;
+    if (!read_pod(in, magic) || magic != GRID_CACHE_MAGIC) return std::nullopt;
+    if (!read_pod(in, version) || version != GRID_CACHE_VERSION) return std::nullopt;
+    if (!read_pod(in, key_len) || key_len != key.size() || key_len > bytes_left(in, file_size)) return std::nullopt;
+
+    std::string stored_key(key_len, '\0');
+    if (!in.read(stored_key.data(), key_len) || stored_key != key) return std::nullopt;
+
+    float cell_size_x = 0, cell_size_y = 0;
+    uint64_t num_lods = 0, num_cells = 0;
+    if (!read_pod(in, cell_size_x) || !read_pod(in, cell_size_y)) return std::nullopt;
+
+    BBox bbox;
+    AttributeRanges ranges;
+    uint8_t has_sh = 0;
+    int32_t sh_degree = 0, num_f_rest = 0;
+    ShEnergy sh_energy;
+    if (!read_pod(in, bbox) || !read_pod(in, ranges) || !read_pod(in, sh_energy) || !read_pod(in, num_lods) ||
+        !read_pod(in, has_sh) || !read_pod(in, sh_degree) || !read_pod(in, num_f_rest) ||
+        !read_pod(in, num_cells)) {
+        return std::nullopt;
+    }
+    // Every cell holds at least its id and a row count per LOD
+    if (num_lods != num_lods_expected || num_cells > bytes_left(in, file_size) / (4 + 8 * num_lods)) {
+        return std::nullopt;
+    }
+
+    SpatialGrid grid(cell_size_x, cell_size_y, static_cast<size_t>(num_lods));
+    grid.bbox_ = bbox;
+    grid.ranges_ = ranges;
+    grid.sh_energy_ = sh_energy;
+    grid.has_sh_ = has_sh != 0;
+    grid.sh_degree_ = sh_degree;
+    grid.num_f_rest_ = num_f_rest;
+
+    std::vector<uint64_t> rows;
+    for (uint64_t c = 0; c < num_cells; ++c) {
+        uint32_t cell_id = 0;
+        if (!read_pod(in, cell_id)) return std::nullopt;
+
+        GridCell cell(cell_id, grid.num_lods_);
+        for (auto& indices : cell.splat_indices) {
+            uint64_t count = 0;
+            if (!read_pod(in, count) || count > bytes_left(in, file_size) / sizeof(uint64_t)) return std::nullopt;
+            rows.resize(static_cast<size_t>(count));
+            if (!in.read(reinterpret_cast<char*>(rows.data()),
+                         static_cast<std::streamsize>(count * sizeof(uint64_t)))) {
+                return std::nullopt;
+            }
+            indices.assign(rows.begin(), rows.end());
+        }
+        grid.cells_.emplace(cell_id, std::move(cell));
+    }
+
+    EnvironmentSplit& split = grid.environment_;
+    uint64_t dropped = 0, count = 0;
+    if (!read_pod(in, split.center) || !read_pod(in, split.radius) || !read_pod(in, dropped) ||
+        !read_pod(in, count) || count > bytes_left(in, file_size) / sizeof(uint64_t)) {
+        return std::nullopt;
+    }
+    rows.resize(static_cast<size_t>(count));
+    if (!in.read(reinterpret_cast<char*>(rows.data()), static_cast<std::streamsize>(count * sizeof(uint64_t)))) {
+        return std::nullopt;
+    }
+    split.dropped = static_cast<size_t>(dropped);
+    split.rows.assign(rows.begin(), rows.end());
+
+    if (!read_pod(in, grid.robust_.bbox_percentile) || !read_pod(in, grid.robust_.range_percentile) ||
+        !read_pod(in, grid.transform_)) {
+        return std::nullopt;
+    }
+
+    // Prune counts, so a warm run reports the same as the run that built the grid
+    for (PruneStats& pruned : grid.prune_stats_) {
+        uint64_t non_finite = 0, opacity = 0, scale = 0;
+        if (!read_pod(in, non_finite) || !read_pod(in, opacity) || !read_pod(in, scale)) return std::nullopt;
+        pruned.non_finite = static_cast<size_t>(non_finite);
+        pruned.opacity = static_cast<size_t>(opacity);
+        pruned.scale = static_cast<size_t>(scale);
+    }
+    uint64_t non_finite_positions = 0;
+    if (!read_pod(in, non_finite_positions)) return std::nullopt;
+    grid.non_finite_positions_ = static_cast<size_t>(non_finite_positions);
+
+    return grid;
 }
 
 } // namespace ply2lcc
@@ -6,47 +6,121 @@
 #include <map>
 #include <string>
 #include <filesystem>
+#include <optional>
 
 namespace ply2lcc {
 
 class SpatialGrid {
 public:
-    // Factory: builds grid from PLY files, computes bbox and ranges
+    // Factory: builds grid from PLY files, computes bbox and ranges.
+    // Splats rejected by `filter` are left out of the bbox, ranges and cells.
+    // With `env` enabled, splats outside the dense core are too (see environment()).
+    // `robust` clips the bbox and attribute ranges at percentiles.
+    // Splats outside `region` are skipped entirely (not counted as pruned); the
+    // bbox pass notes which row blocks reach into it and binning reads only those.
+    // Everything is computed in the frame `transform` rotates the inputs into; the
+    // grid keeps it for its later passes over the files (see transform()).
     static SpatialGrid from_files(const std::vector<std::filesystem::path>& lod_files,
-                                   float cell_size_x, float cell_size_y);
+                                   float cell_size_x, float cell_size_y,
+                                   const SplatFilter& filter = {},
+                                   const EnvSeparation& env = {},
+                                   const RobustRanges& robust = {},
+                                   const Region& region = {},
+                                   const SplatTransform& transform = {});
 
     // Accessors
     const BBox& bbox() const { return bbox_; }
     const AttributeRanges& ranges() const { return ranges_; }
+    const ShEnergy& sh_energy() const { return sh_energy_; }  // over the input LODs
     size_t num_lods() const { return num_lods_; }
     bool has_sh() const { return has_sh_; }
     int sh_degree() const { return sh_degree_; }
     int num_f_rest() const { return num_f_rest_; }
     float cell_size_x() const { return cell_size_x_; }
     float cell_size_y() const { return cell_size_y_; }
+    const std::vector<PruneStats>& prune_stats() const { return prune_stats_; }  // per LOD
+    size_t non_finite_positions() const { return non_finite_positions_; }  // unfiltered inputs, all LODs
+    const EnvironmentSplit& environment() const { return environment_; }  // LOD0 rows outside the core
+    // Input-to-grid frame: pass it to every SplatBuffer reading this grid's LOD files
+    const SplatTransform& transform() const { return transform_; }
 
     // Cell data for encoding
     const std::map<uint32_t, GridCell>& cells() const { return cells_; }
+    std::map<uint32_t, GridCell>& cells() { return cells_; }
 
-    // Cell index computation (thread-safe, no mutation)
+    // Cell index computation (thread-safe, no mutation); positions outside the
+    // bbox map to the nearest edge cell
     uint32_t compute_cell_index(const Vec3f& pos) const;
 
-    // Merge a thread-local grid into this grid
-    void merge(const ThreadLocalGrid& local, size_t lod);
+    // Batch version over separate x/y arrays; same result as compute_cell_index
+    void compute_cell_indices(const float* xs, const float* ys, size_t n, uint32_t* out) const;
+
+    // Merge the binned rows of thread-local grids (in row order) into `lod`
+    void merge(const std::vector<ThreadLocalGrid>& locals, size_t lod);
+
+    // Encode without SH (Portable) even though the inputs carry f_rest
+    void drop_sh() { has_sh_ = false; sh_degree_ = 0; }
+
+    // Add a new coarsest LOD (e.g. generated by LodBuilder) and its ranges
+    void append_lod(ThreadLocalGrid level);
+
+    // Drop rows flagged in drop[lod][row], then recompute bbox, ranges and cells
+    // from the remaining splats so the grid tightens around them (with the same
+    // range clipping as from_files)
+    void remove_rows(const std::vector<std::filesystem::path>& lod_files,
+                     const std::vector<std::vector<uint8_t>>& drop);
+
+    // Split into horizontal slabs of `layer_height` stacked from bbox().min.z; layer k
+    // holds the splats with z in [min.z + k * h, min.z + (k + 1) * h). Returns the
+    // non-empty layers in order. Each keeps this grid's cell ids, cell size, x/y extent
+    // and ranges, so the layers line up; only the bbox z extent tightens to the layer.
+    std::vector<std::pair<int, SpatialGrid>> split_layers(const std::vector<std::filesystem::path>& lod_files,
+                                                          float layer_height) const;
+
+    // Copy holding only the given cells, with everything else unchanged
+    // (a shard of the grid for a worker process)
+    SpatialGrid subset(const std::vector<uint32_t>& cell_ids) const;
+
+    // Grid cache: the grid depends only on the inputs and cell size, so it can be
+    // persisted and reloaded when only output options change.
+    // Key fingerprints each input (path, size, mtime) plus the cell size, filter,
+    // environment separation, range clipping, region and rotation.
+    static std::string cache_key(const std::vector<std::filesystem::path>& lod_files,
+                                 float cell_size_x, float cell_size_y,
+                                 const SplatFilter& filter = {},
+                                 const EnvSeparation& env = {},
+                                 const RobustRanges& robust = {},
+                                 const Region& region = {},
+                                 const SplatTransform& transform = {});
+
+    // Write grid to a binary sidecar. Returns false on I/O error.
+    bool save(const std::filesystem::path& path, const std::string& key) const;
+
+    // Load grid from sidecar; empty if missing, corrupt, key mismatch or not
+    // holding `num_lods` LODs
+    static std::optional<SpatialGrid> load(const std::filesystem::path& path,
+                                           const std::string& key, size_t num_lods);
 
 private:
     SpatialGrid(float cell_size_x, float cell_size_y, size_t num_lods);
     void set_bbox(const BBox& bbox) { bbox_ = bbox; }
+    SpatialGrid empty_copy() const;  // Everything but the cells
 
     float cell_size_x_;
     float cell_size_y_;
     BBox bbox_;
     AttributeRanges ranges_;
+    ShEnergy sh_energy_;
     size_t num_lods_;
     bool has_sh_ = false;
     int sh_degree_ = 0;
     int num_f_rest_ = 0;
     std::map<uint32_t, GridCell> cells_;
+    std::vector<PruneStats> prune_stats_;
+    size_t non_finite_positions_ = 0;
+    EnvironmentSplit environment_;
+    RobustRanges robust_;
+    SplatTransform transform_;
 };
 
 } // namespace ply2lcc
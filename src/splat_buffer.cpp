@@ -1,6 +1,8 @@
 #include "splat_buffer.hpp"
+#include <algorithm>
 #include <cstring>
 #include <iostream>
+#include <omp.h>
 
 namespace ply2lcc {
 
@@ -14,21 +16,78 @@ static int compute_sh_degree(int num_f_rest) {
     return 3;
 }
 
-bool SplatBuffer::initialize(const std::filesystem::path& path) {
+std::vector<std::filesystem::path> SplatBuffer::shard_paths(const std::filesystem::path& path) {
+    const std::string stem = path.stem().u8string();
+    const std::string suffix = "_part0";
+    if (stem.size() <= suffix.size() ||
+        stem.compare(stem.size() - suffix.size(), suffix.size(), suffix) != 0) {
+        return {path};
+    }
+
+    const std::string base = stem.substr(0, stem.size() - 1);
+    const std::string ext = path.extension().u8string();
+    std::vector<std::filesystem::path> paths{path};
+    for (int k = 1;; ++k) {
+        auto part = path.parent_path() / std::filesystem::u8path(base + std::to_string(k) + ext);
+        std::error_code ec;
+        if (!std::filesystem::exists(part, ec)) break;
+        paths.push_back(std::move(part));
+    }
+    return paths;
+}
+
+bool SplatBuffer::initialize(const std::filesystem::path& path, const SplatTransform* transform) {
+    const auto paths = shard_paths(path);
+    m_shards.clear();
+    m_shards.resize(paths.size());
+    m_data = nullptr;
+    m_size = 0;
+
+    // Shards are mapped side by side; row() resolves a global row to its shard
+    for (size_t k = 0; k < paths.size(); ++k) {
+        PropTable table{};
+        if (!map_shard(paths[k], m_shards[k], table)) {
+            if (paths.size() > 1) m_error = paths[k].filename().u8string() + ": " + m_error;
+            m_shards.clear();
+            return false;
+        }
+        if (k == 0) {
+            m_table = table;
+        } else if (table.pos != m_table.pos || table.normal != m_table.normal ||
+                   table.f_dc != m_table.f_dc || table.opacity != m_table.opacity ||
+                   table.scale != m_table.scale || table.rot != m_table.rot ||
+                   table.f_rest != m_table.f_rest || table.row_stride != m_table.row_stride ||
+                   table.num_f_rest != m_table.num_f_rest || table.has_normal != m_table.has_normal) {
+            m_error = "Shard " + paths[k].filename().u8string() + " has a different property layout than " +
+                      paths[0].filename().u8string();
+            m_shards.clear();
+            return false;
+        }
+        m_shards[k].first_row = m_size;
+        m_size += m_shards[k].num_rows;
+    }
+
+    m_table.transform = transform && transform->rotates() ? transform : nullptr;
+    m_data = m_shards[0].data;
+    return true;
+}
+
+bool SplatBuffer::map_shard(const std::filesystem::path& path, Shard& shard, PropTable& table) {
     // Use PLYReaderMmap for PLY parsing and memory mapping
-    m_reader = std::make_unique<PLYReaderMmap>(path);
+    shard.reader = std::make_unique<PLYReaderMmap>(path);
+    PLYReaderMmap* reader = shard.reader.get();
 
-    if (!m_reader->valid()) {
+    if (!reader->valid()) {
         m_error = "Failed to open PLY file: " + path.u8string();
         return false;
     }
 
     // Find vertex element
-    while (m_reader->has_element() && !m_reader->element_is(miniply::kPLYVertexElement)) {
-        m_reader->next_element();
+    while (reader->has_element() && !reader->element_is(miniply::kPLYVertexElement)) {
+        reader->next_element();
     }
 
-    if (!m_reader->has_element()) {
+    if (!reader->has_element()) {
         m_error = "No vertex element found";
         return false;
     }
@@ -36,30 +95,30 @@ bool SplatBuffer::initialize(const std::filesystem::path& path) {
     // Validate required Gaussian splatting properties
     uint32_t pos_idx[3], normal_idx[3], f_dc_idx[3], opacity_idx, scale_idx[3], rot_idx[4];
 
-    if (!m_reader->find_properties(pos_idx, 3, "x", "y", "z")) {
+    if (!reader->find_properties(pos_idx, 3, "x", "y", "z")) {
         m_error = "Missing position properties (x, y, z)";
         return false;
     }
 
-    bool has_normals = m_reader->find_properties(normal_idx, 3, "nx", "ny", "nz");
+    bool has_normals = reader->find_properties(normal_idx, 3, "nx", "ny", "nz");
 
-    if (!m_reader->find_properties(f_dc_idx, 3, "f_dc_0", "f_dc_1", "f_dc_2")) {
+    if (!reader->find_properties(f_dc_idx, 3, "f_dc_0", "f_dc_1", "f_dc_2")) {
         m_error = "Missing f_dc properties - not a Gaussian splatting file";
         return false;
     }
 
-    opacity_idx = m_reader->find_property("opacity");
+    opacity_idx = reader->find_property("opacity");
     if (opacity_idx == miniply::kInvalidIndex) {
         m_error = "Missing opacity property";
         return false;
     }
 
-    if (!m_reader->find_properties(scale_idx, 3, "scale_0", "scale_1", "scale_2")) {
+    if (!reader->find_properties(scale_idx, 3, "scale_0", "scale_1", "scale_2")) {
         m_error = "Missing scale properties";
         return false;
     }
 
-    if (!m_reader->find_properties(rot_idx, 4, "rot_0", "rot_1", "rot_2", "rot_3")) {
+    if (!reader->find_properties(rot_idx, 4, "rot_0", "rot_1", "rot_2", "rot_3")) {
         m_error = "Missing rotation properties";
         return false;
     }
@@ -67,10 +126,10 @@ bool SplatBuffer::initialize(const std::filesystem::path& path) {
     // Count f_rest properties
     uint32_t f_rest_first_idx = miniply::kInvalidIndex;
     int num_f_rest = 0;
-    for (int i = 0; i < 128; ++i) {
+    for (int i = 0; i < MAX_F_REST; ++i) {
         char name[20];
         snprintf(name, sizeof(name), "f_rest_%d", i);
-        uint32_t idx = m_reader->find_property(name);
+        uint32_t idx = reader->find_property(name);
         if (idx == miniply::kInvalidIndex) break;
         if (i == 0) f_rest_first_idx = idx;
         num_f_rest++;
@@ -78,46 +137,49 @@ bool SplatBuffer::initialize(const std::filesystem::path& path) {
 
     // Memory map the element data
     uint32_t rowStride, numRows;
-    const uint8_t* data = m_reader->map_element(&rowStride, &numRows);
+    const uint8_t* data = reader->map_element(&rowStride, &numRows);
     if (!data) {
         m_error = "Failed to map element: " + std::string(
-            m_reader->file_type() != miniply::PLYFileType::Binary
+            reader->file_type() != miniply::PLYFileType::Binary
                 ? "only binary little-endian format supported"
                 : "mapping failed");
         return false;
     }
 
     // Build property table from miniply's element metadata
-    const miniply::PLYElement* elem = m_reader->element();
-
-    m_table.pos = elem->properties[pos_idx[0]].offset;
-    m_table.normal = has_normals ? elem->properties[normal_idx[0]].offset : 0;
-    m_table.f_dc = elem->properties[f_dc_idx[0]].offset;
-    m_table.opacity = elem->properties[opacity_idx].offset;
-    m_table.scale = elem->properties[scale_idx[0]].offset;
-    m_table.rot = elem->properties[rot_idx[0]].offset;
-    m_table.f_rest = (num_f_rest > 0) ? elem->properties[f_rest_first_idx].offset : 0;
-    m_table.row_stride = rowStride;
-    m_table.num_rows = numRows;
-    m_table.num_f_rest = num_f_rest;
-    m_table.sh_degree = compute_sh_degree(num_f_rest);
-    m_table.has_normal = has_normals;
-
-    m_data = data;
+    const miniply::PLYElement* elem = reader->element();
+
+    table.pos = elem->properties[pos_idx[0]].offset;
+    table.normal = has_normals ? elem->properties[normal_idx[0]].offset : 0;
+    table.f_dc = elem->properties[f_dc_idx[0]].offset;
+    table.opacity = elem->properties[opacity_idx].offset;
+    table.scale = elem->properties[scale_idx[0]].offset;
+    table.rot = elem->properties[rot_idx[0]].offset;
+    table.f_rest = (num_f_rest > 0) ? elem->properties[f_rest_first_idx].offset : 0;
+    table.row_stride = rowStride;
+    table.num_rows = numRows;
+    table.num_f_rest = num_f_rest;
+    table.sh_degree = compute_sh_degree(num_f_rest);
+    table.has_normal = has_normals;
+
+    shard.data = data;
+    shard.num_rows = numRows;
     return true;
 }
 
 std::vector<Splat> SplatBuffer::to_vector() const {
     if (!valid()) return {};
 
-    std::vector<Splat> result(m_table.num_rows);
+    std::vector<Splat> result(m_size);
     const int copy_count = std::min(m_table.num_f_rest, 45);
+    float scratch[MAX_F_REST];
 
-    for (uint32_t i = 0; i < m_table.num_rows; ++i) {
+    for (size_t i = 0; i < m_size; ++i) {
         SplatView v = (*this)[i];
         Splat& s = result[i];
 
         s.pos = v.pos();
+        const float* f_rest = v.sh_rest(scratch);
         s.normal = m_table.has_normal ? v.normal() : Vec3f(0, 0, 0);
 
         const Vec3f& dc = v.f_dc();
@@ -127,13 +189,13 @@ std::vector<Splat> SplatBuffer::to_vector() const {
 
         std::memset(s.f_rest, 0, sizeof(s.f_rest));
         for (int j = 0; j < copy_count; ++j) {
-            s.f_rest[j] = v.f_rest(j);
+            s.f_rest[j] = f_rest[j];
         }
 
         s.opacity = v.opacity();
         s.scale = v.scale();
 
-        const Quat& q = v.rot();
+        const Quat q = v.rot();
         s.rot[0] = q.w;
         s.rot[1] = q.x;
         s.rot[2] = q.y;
@@ -144,11 +206,79 @@ std::vector<Splat> SplatBuffer::to_vector() const {
 }
 
 BBox SplatBuffer::compute_bbox() const {
-    BBox bbox;
-    for (uint32_t i = 0; i < m_table.num_rows; ++i) {
-        bbox.expand(pos(i));
+    return compute_stats().bbox;
+}
+
+SplatStats SplatBuffer::compute_stats() const {
+    const int n_threads = omp_get_max_threads();
+    std::vector<SplatStats> local(n_threads);
+    const size_t stride = m_table.row_stride;
+    const SplatTransform* transform = m_table.transform;
+
+    #pragma omp parallel
+    {
+        float lo_x = std::numeric_limits<float>::max(), hi_x = std::numeric_limits<float>::lowest();
+        float lo_y = lo_x, hi_y = hi_x, lo_z = lo_x, hi_z = hi_x;
+        size_t non_finite = 0;
+
+        // Rows are interleaved (AoS), so positions are gathered into per-axis
+        // blocks first and each block is reduced in one vector loop
+        constexpr size_t BLOCK = 1024;
+        float xs[BLOCK], ys[BLOCK], zs[BLOCK];
+
+        // Each shard is contiguous; threads move on to the next shard without waiting
+        for (const Shard& shard : m_shards) {
+            const auto block_count = static_cast<ptrdiff_t>((shard.num_rows + BLOCK - 1) / BLOCK);
+            const uint8_t* base = shard.data + m_table.pos;
+
+            #pragma omp for schedule(static) nowait
+            for (ptrdiff_t b = 0; b < block_count; ++b) {
+                const size_t first = static_cast<size_t>(b) * BLOCK;
+                const size_t n = std::min(BLOCK, shard.num_rows - first);
+                for (size_t k = 0; k < n; ++k) {
+                    float p[3];
+                    std::memcpy(p, base + (first + k) * stride, sizeof(p));
+                    if (transform) {
+                        const Vec3f q = transform->apply_pos(Vec3f(p));
+                        p[0] = q.x;
+                        p[1] = q.y;
+                        p[2] = q.z;
+                    }
+                    xs[k] = p[0];
+                    ys[k] = p[1];
+                    zs[k] = p[2];
+                }
+
+                // v - v is 0 only for finite v, so NaN/Inf rows are masked out
+                // without a branch
+                #pragma omp simd reduction(min : lo_x, lo_y, lo_z) reduction(max : hi_x, hi_y, hi_z) \
+                    reduction(+ : non_finite)
+                for (size_t k = 0; k < n; ++k) {
+                    const float x = xs[k], y = ys[k], z = zs[k];
+                    const bool finite = (x - x == 0.0f) & (y - y == 0.0f) & (z - z == 0.0f);
+                    non_finite += finite ? 0 : 1;
+                    lo_x = finite && x < lo_x ? x : lo_x;
+                    hi_x = finite && x > hi_x ? x : hi_x;
+                    lo_y = finite && y < lo_y ? y : lo_y;
+                    hi_y = finite && y > hi_y ? y : hi_y;
+                    lo_z = finite && z < lo_z ? z : lo_z;
+                    hi_z = finite && z > hi_z ? z : hi_z;
+                }
+            }
+        }
+
+        SplatStats& stats = local[omp_get_thread_num()];
+        stats.bbox.min = Vec3f(lo_x, lo_y, lo_z);
+        stats.bbox.max = Vec3f(hi_x, hi_y, hi_z);
+        stats.non_finite = non_finite;
+    }
+
+    SplatStats stats;
+    for (const auto& s : local) {
+        stats.bbox.expand(s.bbox);
+        stats.non_finite += s.non_finite;
     }
-    return bbox;
+    return stats;
 }
 
 } // namespace ply2lcc
@@ -3,12 +3,17 @@
 
 #include "types.hpp"
 #include "ply_reader_mmap.hpp"
+#include <algorithm>
 #include <cstdint>
 #include <string>
 #include <memory>
+#include <vector>
 
 namespace ply2lcc {
 
+/// f_rest_0 .. f_rest_<MAX_F_REST - 1> are recognised
+constexpr int MAX_F_REST = 128;
+
 /// Property offset table for Gaussian splatting data
 struct PropTable {
     uint32_t pos;
@@ -23,6 +28,13 @@ struct PropTable {
     int num_f_rest;
     int sh_degree;
     bool has_normal;
+    const SplatTransform* transform;  // Rotation applied on read (null = none)
+};
+
+/// Result of a single sweep over all rows (SplatBuffer::compute_stats)
+struct SplatStats {
+    BBox bbox;              // Over rows with finite positions
+    size_t non_finite = 0;  // Rows with a NaN/Inf position component
 };
 
 /// Zero-copy view into a single splat
@@ -31,8 +43,9 @@ public:
     SplatView(const uint8_t* row, const PropTable& table)
         : m_row(row), m_table(table) {}
 
-    const Vec3f& pos() const {
-        return Vec3f::from_ptr(reinterpret_cast<const float*>(m_row + m_table.pos));
+    Vec3f pos() const {
+        const Vec3f& p = Vec3f::from_ptr(reinterpret_cast<const float*>(m_row + m_table.pos));
+        return m_table.transform ? m_table.transform->apply_pos(p) : p;
     }
 
     const Vec3f& normal() const {
@@ -51,14 +64,26 @@ public:
         return Vec3f::from_ptr(reinterpret_cast<const float*>(m_row + m_table.scale));
     }
 
-    const Quat& rot() const {
-        return Quat::from_ptr(reinterpret_cast<const float*>(m_row + m_table.rot));
+    Quat rot() const {
+        const Quat& q = Quat::from_ptr(reinterpret_cast<const float*>(m_row + m_table.rot));
+        return m_table.transform ? m_table.transform->apply_rot(q) : q;
     }
 
+    // Coefficient as stored in the file (not rotated)
     const float& f_rest(int i) const {
         return *reinterpret_cast<const float*>(m_row + m_table.f_rest + i * sizeof(float));
     }
 
+    // All num_f_rest() coefficients in file order. Points into the row, or into
+    // `scratch` (MAX_F_REST floats) with the SH bands rotated under a transform
+    const float* sh_rest(float* scratch) const {
+        const float* coeffs = reinterpret_cast<const float*>(m_row + m_table.f_rest);
+        if (!m_table.transform || m_table.num_f_rest == 0) return coeffs;
+        std::copy(coeffs, coeffs + m_table.num_f_rest, scratch);
+        m_table.transform->apply_sh(scratch, m_table.num_f_rest);
+        return scratch;
+    }
+
     int num_f_rest() const { return m_table.num_f_rest; }
     bool has_normal() const { return m_table.has_normal; }
 
@@ -67,7 +92,9 @@ private:
     const PropTable& m_table;
 };
 
-/// Iterator over splats
+class SplatBuffer;
+
+/// Iterator over splats (by row index, so it works across shards)
 class SplatIterator {
 public:
     using iterator_category = std::random_access_iterator_tag;
@@ -76,13 +103,13 @@ public:
     using pointer = void;
     using reference = SplatView;
 
-    SplatIterator(const uint8_t* row, const PropTable* table)
-        : m_row(row), m_table(table) {}
+    SplatIterator(const SplatBuffer* buffer, size_t index)
+        : m_buffer(buffer), m_index(index) {}
 
-    SplatView operator*() const { return SplatView(m_row, *m_table); }
+    inline SplatView operator*() const;
 
     SplatIterator& operator++() {
-        m_row += m_table->row_stride;
+        ++m_index;
         return *this;
     }
 
@@ -93,34 +120,38 @@ public:
     }
 
     SplatIterator& operator--() {
-        m_row -= m_table->row_stride;
+        --m_index;
         return *this;
     }
 
     SplatIterator& operator+=(difference_type n) {
-        m_row += n * m_table->row_stride;
+        m_index += n;
         return *this;
     }
 
     SplatIterator operator+(difference_type n) const {
-        return SplatIterator(m_row + n * m_table->row_stride, m_table);
+        return SplatIterator(m_buffer, m_index + n);
     }
 
     difference_type operator-(const SplatIterator& other) const {
-        return (m_row - other.m_row) / static_cast<difference_type>(m_table->row_stride);
+        return static_cast<difference_type>(m_index) - static_cast<difference_type>(other.m_index);
     }
 
-    bool operator==(const SplatIterator& other) const { return m_row == other.m_row; }
-    bool operator!=(const SplatIterator& other) const { return m_row != other.m_row; }
-    bool operator<(const SplatIterator& other) const { return m_row < other.m_row; }
+    bool operator==(const SplatIterator& other) const { return m_index == other.m_index; }
+    bool operator!=(const SplatIterator& other) const { return m_index != other.m_index; }
+    bool operator<(const SplatIterator& other) const { return m_index < other.m_index; }
 
 private:
-    const uint8_t* m_row;
-    const PropTable* m_table;
+    const SplatBuffer* m_buffer;
+    size_t m_index;
 };
 
 /// Memory-mapped buffer over Gaussian splatting PLY data (zero-copy)
-/// Owns a PLYReaderMmap and validates the data is valid splat format
+/// Owns a PLYReaderMmap per shard and validates the data is valid splat format.
+/// A file named <base>_part0.ply is read together with its siblings
+/// <base>_part1.ply, ... as one logical cloud: row i of shard k is global row
+/// (rows in shards 0..k-1) + i, so grid indices carry (shard, row) without
+/// copying the shards into one file.
 class SplatBuffer {
 public:
     SplatBuffer() = default;
@@ -132,25 +163,38 @@ public:
     SplatBuffer(SplatBuffer&&) = default;
     SplatBuffer& operator=(SplatBuffer&&) = default;
 
-    /// Initialize from a PLY file. Returns false on error (check error()).
-    bool initialize(const std::filesystem::path& path);
+    /// Initialize from a PLY file, or from all shards of a <base>_part0.ply.
+    /// Views rotate positions, orientations and SH by `transform` if it rotates;
+    /// it must outlive the buffer. Returns false on error (check error()).
+    bool initialize(const std::filesystem::path& path, const SplatTransform* transform = nullptr);
+
+    /// Files read for `path`: <base>_part0.ply, <base>_part1.ply, ... up to the
+    /// first missing part, or just `path` when it is not a part0 shard
+    static std::vector<std::filesystem::path> shard_paths(const std::filesystem::path& path);
 
     bool valid() const { return m_data != nullptr; }
-    size_t size() const { return m_table.num_rows; }
+    size_t size() const { return m_size; }
+    size_t num_shards() const { return m_shards.size(); }
 
     SplatView operator[](size_t i) const {
-        return SplatView(m_data + i * m_table.row_stride, m_table);
+        return SplatView(row(i), m_table);
     }
 
-    SplatIterator begin() const { return SplatIterator(m_data, &m_table); }
-    SplatIterator end() const {
-        return SplatIterator(m_data + m_table.num_rows * m_table.row_stride, &m_table);
+    SplatIterator begin() const { return SplatIterator(this, 0); }
+    SplatIterator end() const { return SplatIterator(this, m_size); }
+
+    // Raw row bytes (row_stride bytes per splat)
+    const uint8_t* row(size_t i) const {
+        if (m_shards.size() <= 1) return m_data + i * m_table.row_stride;
+        // Last shard whose first row is <= i
+        auto it = std::upper_bound(m_shards.begin() + 1, m_shards.end(), i,
+                                   [](size_t r, const Shard& s) { return r < s.first_row; }) - 1;
+        return it->data + (i - it->first_row) * m_table.row_stride;
     }
 
     // Convenience accessor
-    const Vec3f& pos(size_t i) const {
-        return Vec3f::from_ptr(reinterpret_cast<const float*>(
-            m_data + i * m_table.row_stride + m_table.pos));
+    Vec3f pos(size_t i) const {
+        return (*this)[i].pos();
     }
 
     // Metadata
@@ -165,16 +209,32 @@ public:
     // Materialize to vector<Splat> for compatibility with legacy code
     std::vector<Splat> to_vector() const;
 
-    // Compute bounding box
+    // Compute bounding box (parallel, see compute_stats)
     BBox compute_bbox() const;
 
+    // Bbox and non-finite position count in one parallel sweep with
+    // per-thread partials merged at the end
+    SplatStats compute_stats() const;
+
 private:
-    std::unique_ptr<PLYReaderMmap> m_reader;
-    const uint8_t* m_data = nullptr;
-    PropTable m_table{};
+    struct Shard {
+        std::unique_ptr<PLYReaderMmap> reader;
+        const uint8_t* data = nullptr;
+        size_t first_row = 0;
+        uint32_t num_rows = 0;
+    };
+
+    bool map_shard(const std::filesystem::path& path, Shard& shard, PropTable& table);
+
+    std::vector<Shard> m_shards;
+    const uint8_t* m_data = nullptr;  // First shard's rows
+    size_t m_size = 0;                // Rows over all shards
+    PropTable m_table{};              // Layout shared by all shards; num_rows is the first shard's
     std::string m_error;
 };
 
+inline SplatView SplatIterator::operator*() const { return (*m_buffer)[m_index]; }
+
 } // namespace ply2lcc
 
 #endif // PLY2LCC_SPLAT_BUFFER_HPP
@@ -0,0 +1,219 @@
+#include "splat_order.hpp"
+#include <cmath>
+#include <omp.h>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+namespace ply2lcc {
+
+// Cells at least this large are sorted one at a time with a parallel radix sort;
+// smaller cells are sorted concurrently, one per thread.
+static constexpr size_t PARALLEL_SORT_THRESHOLD = size_t(1) << 20;
+
+static constexpr int KEY_BITS = 21;
+
+// Spread the low 21 bits of v so there are two zero bits between each
+static uint64_t split_by_3(uint32_t v) {
+    uint64_t x = v & 0x1FFFFF;
+    x = (x | (x << 32)) & 0x1F00000000FFFFULL;
+    x = (x | (x << 16)) & 0x1F0000FF0000FFULL;
+    x = (x | (x << 8))  & 0x100F00F00F00F00FULL;
+    x = (x | (x << 4))  & 0x10C30C30C30C30C3ULL;
+    x = (x | (x << 2))  & 0x1249249249249249ULL;
+    return x;
+}
+
+float splat_importance(const SplatView& splat) {
+    const Vec3f& s = splat.scale();
+    float score = sigmoid(splat.opacity()) * std::exp(s.x + s.y + s.z);
+    return std::isnan(score) ? 0.0f : score;
+}
+
+uint64_t morton_key_3d(uint32_t x, uint32_t y, uint32_t z) {
+    return split_by_3(x) | (split_by_3(y) << 1) | (split_by_3(z) << 2);
+}
+
+uint64_t hilbert_key_3d(uint32_t x, uint32_t y, uint32_t z, int bits) {
+    // Skilling, "Programming the Hilbert curve" (2004): axes -> transposed index
+    uint32_t X[3] = {x, y, z};
+    const uint32_t M = 1u << (bits - 1);
+
+    for (uint32_t Q = M; Q > 1; Q >>= 1) {
+        uint32_t P = Q - 1;
+        for (int i = 0; i < 3; ++i) {
+            if (X[i] & Q) {
+                X[0] ^= P;
+            } else {
+                uint32_t t = (X[0] ^ X[i]) & P;
+                X[0] ^= t;
+                X[i] ^= t;
+            }
+        }
+    }
+
+    // Gray encode
+    for (int i = 1; i < 3; ++i) X[i] ^= X[i - 1];
+    uint32_t t = 0;
+    for (uint32_t Q = M; Q > 1; Q >>= 1) {
+        if (X[2] & Q) t ^= Q - 1;
+    }
+    for (int i = 0; i < 3; ++i) X[i] ^= t;
+
+    // Interleave the transposed bits, most significant first
+    uint64_t key = 0;
+    for (int b = bits - 1; b >= 0; --b) {
+        for (int i = 0; i < 3; ++i) {
+            key = (key << 1) | ((X[i] >> b) & 1u);
+        }
+    }
+    return key;
+}
+
+void radix_sort_by_key(std::vector<uint64_t>& keys, std::vector<size_t>& values, bool parallel) {
+    const size_t n = keys.size();
+    if (n < 2) return;
+
+    // Digits that are identical in every key need no pass
+    uint64_t varying = 0;
+    for (size_t i = 1; i < n; ++i) {
+        varying |= keys[i] ^ keys[0];
+    }
+
+    std::vector<uint64_t> keys_tmp(n);
+    std::vector<size_t> values_tmp(n);
+
+    const int max_threads = parallel ? omp_get_max_threads() : 1;
+    std::vector<std::array<size_t, 256>> hist(max_threads);
+
+    for (int shift = 0; shift < 64; shift += 8) {
+        if (((varying >> shift) & 0xFF) == 0) continue;
+
+        #pragma omp parallel num_threads(max_threads) if(parallel)
+        {
+            const int tid = omp_get_thread_num();
+            const int nt = omp_get_num_threads();
+            const size_t begin = n * tid / nt;
+            const size_t end = n * (tid + 1) / nt;
+
+            auto& h = hist[tid];
+            h.fill(0);
+            for (size_t i = begin; i < end; ++i) {
+                h[(keys[i] >> shift) & 0xFF]++;
+            }
+
+            #pragma omp barrier
+
+            // Exclusive prefix sum in (bucket, thread) order keeps the sort stable
+            #pragma omp single
+            {
+                size_t sum = 0;
+                for (int b = 0; b < 256; ++b) {
+                    for (int t = 0; t < nt; ++t) {
+                        size_t c = hist[t][b];
+                        hist[t][b] = sum;
+                        sum += c;
+                    }
+                }
+            }
+
+            for (size_t i = begin; i < end; ++i) {
+                size_t pos = h[(keys[i] >> shift) & 0xFF]++;
+                keys_tmp[pos] = keys[i];
+                values_tmp[pos] = values[i];
+            }
+        }
+
+        keys.swap(keys_tmp);
+        values.swap(values_tmp);
+    }
+}
+
+// Descending importance: invert the bits of the (non-negative) float score
+static uint64_t importance_key(const SplatView& splat) {
+    float score = splat_importance(splat);
+    uint32_t bits;
+    std::memcpy(&bits, &score, sizeof(bits));
+    return 0xFFFFFFFFu - bits;
+}
+
+static void sort_indices(const SplatBuffer& splats, std::vector<size_t>& indices,
+                         SplatOrder order, bool parallel) {
+    const auto n = static_cast<ptrdiff_t>(indices.size());
+    if (n < 2) return;
+
+    std::vector<uint64_t> keys(indices.size());
+
+    if (order == SplatOrder::Importance) {
+        #pragma omp parallel for schedule(static) if(parallel)
+        for (ptrdiff_t i = 0; i < n; ++i) {
+            keys[static_cast<size_t>(i)] = importance_key(splats[indices[static_cast<size_t>(i)]]);
+        }
+        radix_sort_by_key(keys, indices, parallel);
+        return;
+    }
+
+    BBox bounds;
+    for (size_t idx : indices) {
+        bounds.expand(splats.pos(idx));
+    }
+
+    const float max_q = static_cast<float>((1u << KEY_BITS) - 1);
+    float inv_extent[3];
+    for (int a = 0; a < 3; ++a) {
+        float extent = bounds.max[a] - bounds.min[a];
+        inv_extent[a] = extent > 0.0f ? max_q / extent : 0.0f;
+    }
+
+    #pragma omp parallel for schedule(static) if(parallel)
+    for (ptrdiff_t i = 0; i < n; ++i) {
+        const Vec3f& p = splats.pos(indices[static_cast<size_t>(i)]);
+        uint32_t q[3];
+        for (int a = 0; a < 3; ++a) {
+            q[a] = static_cast<uint32_t>(clamp((p[a] - bounds.min[a]) * inv_extent[a], 0.0f, max_q));
+        }
+        keys[static_cast<size_t>(i)] = (order == SplatOrder::Hilbert)
+            ? hilbert_key_3d(q[0], q[1], q[2], KEY_BITS)
+            : morton_key_3d(q[0], q[1], q[2]);
+    }
+
+    radix_sort_by_key(keys, indices, parallel);
+}
+
+void sort_cell_splats(SpatialGrid& grid,
+                      const std::vector<std::filesystem::path>& lod_files,
+                      SplatOrder order) {
+    if (order == SplatOrder::Input) return;
+
+    for (size_t lod = 0; lod < grid.num_lods(); ++lod) {
+        SplatBuffer splats;
+        if (!splats.initialize(lod_files[lod], &grid.transform())) {
+            throw std::runtime_error("Failed to read " + lod_files[lod].u8string() + ": " + splats.error());
+        }
+
+        std::vector<std::vector<size_t>*> small_cells;
+        std::vector<std::vector<size_t>*> large_cells;
+        for (auto& [id, cell] : grid.cells()) {
+            auto& indices = cell.splat_indices[lod];
+            if (indices.size() >= PARALLEL_SORT_THRESHOLD) {
+                large_cells.push_back(&indices);
+            } else if (indices.size() > 1) {
+                small_cells.push_back(&indices);
+            }
+        }
+
+        for (auto* indices : large_cells) {
+            sort_indices(splats, *indices, order, true);
+        }
+
+        const auto small_count = static_cast<ptrdiff_t>(small_cells.size());
+
+        #pragma omp parallel for schedule(dynamic)
+        for (ptrdiff_t i = 0; i < small_count; ++i) {
+            sort_indices(splats, *small_cells[static_cast<size_t>(i)], order, false);
+        }
+    }
+}
+
+} // namespace ply2lcc
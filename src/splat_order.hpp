@@ -0,0 +1,36 @@
+#ifndef PLY2LCC_SPLAT_ORDER_HPP
+#define PLY2LCC_SPLAT_ORDER_HPP
+
+#include "types.hpp"
+#include "spatial_grid.hpp"
+#include "splat_buffer.hpp"
+#include <cstdint>
+#include <vector>
+#include <filesystem>
+
+namespace ply2lcc {
+
+// Reorder every cell's splat indices (per LOD) by the given order.
+// Curve orders quantise positions to 21 bits per axis within each cell's own bounds;
+// Importance sorts by descending splat_importance() so any prefix of a cell is a
+// usable approximation. Ties keep input order.
+void sort_cell_splats(SpatialGrid& grid,
+                      const std::vector<std::filesystem::path>& lod_files,
+                      SplatOrder order);
+
+// Visual importance of a splat: sigmoid(opacity) * ellipsoid volume (exp of the log scales)
+float splat_importance(const SplatView& splat);
+
+// 3D Morton (Z-order) key: interleaves the low 21 bits of x, y, z
+uint64_t morton_key_3d(uint32_t x, uint32_t y, uint32_t z);
+
+// 3D Hilbert key for coordinates of `bits` bits each (bits <= 21)
+uint64_t hilbert_key_3d(uint32_t x, uint32_t y, uint32_t z, int bits);
+
+// Stable LSD radix sort of values by 64-bit keys (both vectors are permuted).
+// With parallel = true each digit pass is split across OpenMP threads.
+void radix_sort_by_key(std::vector<uint64_t>& keys, std::vector<size_t>& values, bool parallel);
+
+} // namespace ply2lcc
+
+#endif // PLY2LCC_SPLAT_ORDER_HPP
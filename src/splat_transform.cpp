@@ -0,0 +1,211 @@
+#include "types.hpp"
+#include <stdexcept>
+
+namespace ply2lcc {
+
+// SplatTransform (types.hpp): matrix validation and the SH band rotations
+
+namespace {
+
+using Dir = std::array<double, 3>;
+
+// Real SH of bands 1-3 at unit direction d, in the order and normalisation the
+// 3DGS renderer evaluates f_rest with
+void eval_band1(const Dir& d, double* out) {
+    const double C1 = 0.4886025119029199;
+    const double x = d[0], y = d[1], z = d[2];
+    out[0] = -C1 * y;
+    out[1] = C1 * z;
+    out[2] = -C1 * x;
+}
+
+void eval_band2(const Dir& d, double* out) {
+    const double x = d[0], y = d[1], z = d[2];
+    out[0] = 1.0925484305920792 * x * y;
+    out[1] = -1.0925484305920792 * y * z;
+    out[2] = 0.31539156525252005 * (2.0 * z * z - x * x - y * y);
+    out[3] = -1.0925484305920792 * x * z;
+    out[4] = 0.5462742152960396 * (x * x - y * y);
+}
+
+void eval_band3(const Dir& d, double* out) {
+    const double x = d[0], y = d[1], z = d[2];
+    out[0] = -0.5900435899266435 * y * (3.0 * x * x - y * y);
+    out[1] = 2.890611442640554 * x * y * z;
+    out[2] = -0.4570457994644658 * y * (4.0 * z * z - x * x - y * y);
+    out[3] = 0.3731763325901154 * z * (2.0 * z * z - 3.0 * x * x - 3.0 * y * y);
+    out[4] = -0.4570457994644658 * x * (4.0 * z * z - x * x - y * y);
+    out[5] = 1.445305721320277 * z * (x * x - y * y);
+    out[6] = -0.5900435899266435 * x * (x * x - 3.0 * y * y);
+}
+
+// Wigner matrix D of one band: the rotated function f(R^T d) has coefficients
+// D c. Fitted by least squares on a Fibonacci sphere of directions, which
+// determines D exactly because the band is closed under rotation
+template <int N>
+void band_rotation(const double r[3][3], void (*eval)(const Dir&, double*), float out[N][N]) {
+    constexpr int SAMPLES = 64;
+    double ata[N][N] = {};
+    double atb[N][N] = {};
+    for (int i = 0; i < SAMPLES; ++i) {
+        const double z = 1.0 - (2.0 * i + 1.0) / SAMPLES;
+        const double radius = std::sqrt(1.0 - z * z);
+        const double phi = 2.399963229728653 * i;  // Golden angle
+        const Dir d{radius * std::cos(phi), radius * std::sin(phi), z};
+        const Dir back{r[0][0] * d[0] + r[1][0] * d[1] + r[2][0] * d[2],
+                       r[0][1] * d[0] + r[1][1] * d[1] + r[2][1] * d[2],
+                       r[0][2] * d[0] + r[1][2] * d[1] + r[2][2] * d[2]};
+        double a[N], b[N];
+        eval(d, a);
+        eval(back, b);
+        for (int m = 0; m < N; ++m) {
+            for (int k = 0; k < N; ++k) {
+                ata[m][k] += a[m] * a[k];
+                atb[m][k] += a[m] * b[k];
+            }
+        }
+    }
+
+    // Solve ata * D = atb by Gauss-Jordan elimination (ata is symmetric positive definite)
+    for (int col = 0; col < N; ++col) {
+        int pivot = col;
+        for (int row = col + 1; row < N; ++row) {
+            if (std::abs(ata[row][col]) > std::abs(ata[pivot][col])) pivot = row;
+        }
+        std::swap(ata[col], ata[pivot]);
+        std::swap(atb[col], atb[pivot]);
+        const double inv = 1.0 / ata[col][col];
+        for (int k = 0; k < N; ++k) {
+            ata[col][k] *= inv;
+            atb[col][k] *= inv;
+        }
+        for (int row = 0; row < N; ++row) {
+            if (row == col) continue;
+            const double f = ata[row][col];
+            for (int k = 0; k < N; ++k) {
+                ata[row][k] -= f * ata[col][k];
+                atb[row][k] -= f * atb[col][k];
+            }
+        }
+    }
+    for (int m = 0; m < N; ++m) {
+        for (int k = 0; k < N; ++k) out[m][k] = static_cast<float>(atb[m][k]);
+    }
+}
+
+template <int N>
+void rotate_band(const float d[N][N], float* coeffs) {
+    float in[N];
+    std::copy(coeffs, coeffs + N, in);
+    for (int m = 0; m < N; ++m) {
+        float sum = 0.0f;
+        for (int k = 0; k < N; ++k) sum += d[m][k] * in[k];
+        coeffs[m] = sum;
+    }
+}
+
+// Unit quaternion (w, x, y, z) of a proper rotation matrix
+std::array<double, 4> to_quat(const double r[3][3]) {
+    double w, x, y, z;
+    const double trace = r[0][0] + r[1][1] + r[2][2];
+    if (trace > 0.0) {
+        const double s = 2.0 * std::sqrt(trace + 1.0);
+        w = 0.25 * s;
+        x = (r[2][1] - r[1][2]) / s;
+        y = (r[0][2] - r[2][0]) / s;
+        z = (r[1][0] - r[0][1]) / s;
+    } else if (r[0][0] > r[1][1] && r[0][0] > r[2][2]) {
+        const double s = 2.0 * std::sqrt(1.0 + r[0][0] - r[1][1] - r[2][2]);
+        w = (r[2][1] - r[1][2]) / s;
+        x = 0.25 * s;
+        y = (r[0][1] + r[1][0]) / s;
+        z = (r[0][2] + r[2][0]) / s;
+    } else if (r[1][1] > r[2][2]) {
+        const double s = 2.0 * std::sqrt(1.0 + r[1][1] - r[0][0] - r[2][2]);
+        w = (r[0][2] - r[2][0]) / s;
+        x = (r[0][1] + r[1][0]) / s;
+        y = 0.25 * s;
+        z = (r[1][2] + r[2][1]) / s;
+    } else {
+        const double s = 2.0 * std::sqrt(1.0 + r[2][2] - r[0][0] - r[1][1]);
+        w = (r[1][0] - r[0][1]) / s;
+        x = (r[0][2] + r[2][0]) / s;
+        y = (r[1][2] + r[2][1]) / s;
+        z = 0.25 * s;
+    }
+    const double n = std::sqrt(w * w + x * x + y * y + z * z);
+    return {w / n, x / n, y / n, z / n};
+}
+
+} // namespace
+
+SplatTransform SplatTransform::from_matrix(const double m[16]) {
+    for (int i = 0; i < 16; ++i) {
+        if (!std::isfinite(m[i])) throw std::runtime_error("Transform has a non-finite entry");
+    }
+    if (m[12] != 0.0 || m[13] != 0.0 || m[14] != 0.0 || m[15] != 1.0) {
+        throw std::runtime_error("Transform bottom row must be 0 0 0 1");
+    }
+
+    const double a[3][3] = {{m[0], m[1], m[2]}, {m[4], m[5], m[6]}, {m[8], m[9], m[10]}};
+    const double det = a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1]) -
+                       a[0][1] * (a[1][0] * a[2][2] - a[1][2] * a[2][0]) +
+                       a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0]);
+    if (!(det > 0.0)) {
+        throw std::runtime_error("Transform must not mirror or collapse the scene");
+    }
+
+    SplatTransform t;
+    t.scale = std::cbrt(det);
+    t.translation[0] = m[3];
+    t.translation[1] = m[7];
+    t.translation[2] = m[11];
+
+    // Rebuild the rotation from its quaternion so it is exactly orthonormal in float
+    double r[3][3];
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) r[i][j] = a[i][j] / t.scale;
+    }
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            const double dot = r[0][i] * r[0][j] + r[1][i] * r[1][j] + r[2][i] * r[2][j];
+            if (std::abs(dot - (i == j ? 1.0 : 0.0)) > 1e-4) {
+                throw std::runtime_error("Transform must be a rotation, uniform scale and translation "
+                                         "(no shear or per-axis scale)");
+            }
+        }
+    }
+    const auto [w, x, y, z] = to_quat(r);
+    t.rotation_quat = Quat(static_cast<float>(w), static_cast<float>(x), static_cast<float>(y),
+                           static_cast<float>(z));
+    r[0][0] = 1 - 2 * (y * y + z * z); r[0][1] = 2 * (x * y - w * z);     r[0][2] = 2 * (x * z + w * y);
+    r[1][0] = 2 * (x * y + w * z);     r[1][1] = 1 - 2 * (x * x + z * z); r[1][2] = 2 * (y * z - w * x);
+    r[2][0] = 2 * (x * z - w * y);     r[2][1] = 2 * (y * z + w * x);     r[2][2] = 1 - 2 * (x * x + y * y);
+
+    // Snap round-off so an identity or axis-swap input reports rotates() exactly
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            if (std::abs(r[i][j]) < 1e-12) r[i][j] = 0.0;
+            if (std::abs(std::abs(r[i][j]) - 1.0) < 1e-12) r[i][j] = std::copysign(1.0, r[i][j]);
+            t.rotation[i][j] = static_cast<float>(r[i][j]);
+        }
+    }
+
+    band_rotation<3>(r, eval_band1, t.sh_band1);
+    band_rotation<5>(r, eval_band2, t.sh_band2);
+    band_rotation<7>(r, eval_band3, t.sh_band3);
+    return t;
+}
+
+void SplatTransform::apply_sh(float* f_rest, int num_f_rest) const {
+    if (!rotates()) return;  // Band matrices are only set by from_matrix
+    const int per_channel = num_f_rest / 3;
+    for (int c = 0; c < 3; ++c) {
+        float* coeffs = f_rest + c * per_channel;
+        if (per_channel >= 3) rotate_band<3>(sh_band1, coeffs);
+        if (per_channel >= 8) rotate_band<5>(sh_band2, coeffs + 3);
+        if (per_channel >= 15) rotate_band<7>(sh_band3, coeffs + 8);
+    }
+}
+
+} // namespace ply2lcc
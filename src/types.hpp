@@ -1,6 +1,7 @@
 #ifndef PLY2LCC_TYPES_HPP
 #define PLY2LCC_TYPES_HPP
 
+#include <algorithm>
 #include <cstdint>
 #include <vector>
 #include <array>
@@ -10,6 +11,7 @@
 #include <cmath>
 #include <map>
 #include <functional>
+#include "quantile_sketch.hpp"
 
 namespace ply2lcc {
 
@@ -127,6 +129,37 @@ struct AttributeRanges {
     }
 };
 
+// Opacity-weighted SH energy, gathered in the range pass to judge whether the
+// view-dependent colour (f_rest) is worth the extra 64 bytes per splat of Quality output
+struct ShEnergy {
+    static constexpr double SH_C0 = 0.28209479177387814;
+
+    double weight = 0.0;        // Sum of sigmoid(opacity)
+    double dc_sq = 0.0;         // Weighted sum of f_dc^2 over the 3 channels
+    double band_sq[3] = {};     // Per SH degree 1..3: weighted sum of f_rest^2 over channels
+
+    void merge(const ShEnergy& other) {
+        weight += other.weight;
+        dc_sq += other.dc_sq;
+        for (int l = 0; l < 3; ++l) band_sq[l] += other.band_sq[l];
+    }
+
+    // RMS of one degree-l coefficient (l = 1..3) relative to the RMS of f_dc
+    double band_ratio(int l) const {
+        return dc_sq > 0.0 ? std::sqrt(band_sq[l - 1] / ((2 * l + 1) * dc_sq)) : 0.0;
+    }
+
+    // Amplitude of the whole view-dependent term relative to f_dc
+    double total_ratio() const {
+        return dc_sq > 0.0 ? std::sqrt((band_sq[0] + band_sq[1] + band_sq[2]) / dc_sq) : 0.0;
+    }
+
+    // RMS colour change per channel (0..1), averaged over view directions, from dropping f_rest
+    double view_dependent_rms() const {
+        return weight > 0.0 ? SH_C0 * std::sqrt((band_sq[0] + band_sq[1] + band_sq[2]) / (3.0 * weight)) : 0.0;
+    }
+};
+
 struct EnvBounds {
     Vec3f pos_min{std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
     Vec3f pos_max{std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()};
@@ -177,9 +210,226 @@ struct EncodedCell {
     size_t count = 0;
 };
 
+// Quantile sketches behind RobustRanges, filled alongside AttributeRanges
+struct RangeSketch {
+    std::array<QuantileSketch, 3> scale;  // Linear, per axis
+    std::array<QuantileSketch, 3> sh;     // Per color channel
+
+    void merge(const RangeSketch& other) {
+        for (int i = 0; i < 3; ++i) {
+            scale[i].merge(other.scale[i]);
+            sh[i].merge(other.sh[i]);
+        }
+    }
+
+    // Narrow `ranges` to leave out `tail` of the values on each side
+    void clip(AttributeRanges& ranges, double tail) const {
+        for (int i = 0; i < 3; ++i) {
+            if (scale[i].count() > 0) {
+                auto [lo, hi] = scale[i].range(tail);
+                ranges.scale_min[i] = std::max(ranges.scale_min[i], lo);
+                ranges.scale_max[i] = std::min(ranges.scale_max[i], hi);
+            }
+            if (sh[i].count() > 0) {
+                auto [lo, hi] = sh[i].range(tail);
+                ranges.sh_min[i] = std::max(ranges.sh_min[i], lo);
+                ranges.sh_max[i] = std::min(ranges.sh_max[i], hi);
+            }
+        }
+    }
+};
+
 struct ThreadLocalGrid {
-    std::map<uint32_t, std::vector<size_t>> cell_indices;  // cell_id -> splat indices
+    // Binned (cell id, row) pairs, sorted by cell id with rows ascending within a cell
+    std::vector<uint32_t> cell_ids;
+    std::vector<uint64_t> rows;
     AttributeRanges ranges;
+    ShEnergy sh_energy;
+    RangeSketch sketch;  // Only filled when RobustRanges clips attribute ranges
+};
+
+// Order of splats within each cell's data.bin range
+enum class SplatOrder {
+    Input,    // Input file order
+    Morton,   // 3D Z-order curve
+    Hilbert,    // 3D Hilbert curve
+    Importance  // Most visually important first (progressive streaming)
+};
+
+// Order of cells in data.bin, shcoef.bin and index.bin
+enum class CellLayout {
+    Column,   // cell_x, then cell_y (default)
+    ZOrder,   // 2D Morton curve over (cell_x, cell_y)
+    Hilbert   // 2D Hilbert curve over (cell_x, cell_y)
+};
+
+// Drops effectively invisible or corrupt splats while binning (0 disables a threshold)
+struct SplatFilter {
+    float min_opacity = 0.0f;      // After sigmoid(); 1/255 drops fully transparent splats
+    float min_scale = 0.0f;        // Largest linear axis, in meters
+    bool drop_non_finite = false;  // NaN/Inf in any attribute
+
+    bool enabled() const { return min_opacity > 0.0f || min_scale > 0.0f || drop_non_finite; }
+};
+
+// Splats dropped by SplatFilter for one LOD, by first failing test
+struct PruneStats {
+    size_t non_finite = 0;
+    size_t opacity = 0;
+    size_t scale = 0;
+
+    size_t total() const { return non_finite + opacity + scale; }
+};
+
+// Statistical floater removal: drops splats whose mean distance to their k nearest
+// neighbours exceeds mean + sigma * stddev of that distance over the LOD
+struct FloaterFilter {
+    int k = 0;            // Neighbours per splat (0 disables)
+    float sigma = 3.0f;
+
+    bool enabled() const { return k > 0; }
+};
+
+// Moves sky and far-background splats out of the grid: LOD0 splats farther than
+// radius_factor x the 90th-percentile distance from the median center go to the
+// environment stream, and far splats of coarser LODs are dropped
+struct EnvSeparation {
+    float radius_factor = 0.0f;  // 0 disables
+    size_t sample_size = 1 << 20;  // LOD0 splats sampled for the core estimate
+
+    bool enabled() const { return radius_factor > 0.0f; }
+};
+
+// Part of space a conversion is restricted to: a box, optionally narrowed to an
+// x/y polygon (--crop, tiles). Half-open, so adjacent tiles never share a splat;
+// unbounded by default
+struct Region {
+    float min_x = -std::numeric_limits<float>::infinity();
+    float min_y = -std::numeric_limits<float>::infinity();
+    float max_x = std::numeric_limits<float>::infinity();
+    float max_y = std::numeric_limits<float>::infinity();
+    float min_z = -std::numeric_limits<float>::infinity();
+    float max_z = std::numeric_limits<float>::infinity();
+    std::vector<std::array<float, 2>> polygon;  // x/y vertices, even-odd rule (empty = box only)
+
+    bool enabled() const {
+        return std::isfinite(min_x) || std::isfinite(min_y) || std::isfinite(max_x) || std::isfinite(max_y) ||
+               std::isfinite(min_z) || std::isfinite(max_z) || !polygon.empty();
+    }
+    bool contains(const Vec3f& p) const {
+        if (!(p.x >= min_x && p.x < max_x && p.y >= min_y && p.y < max_y && p.z >= min_z && p.z < max_z)) {
+            return false;
+        }
+        return polygon.empty() || in_polygon(p.x, p.y);
+    }
+    bool in_polygon(float x, float y) const {
+        bool inside = false;
+        for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+            const auto& a = polygon[i];
+            const auto& b = polygon[j];
+            if ((a[1] > y) != (b[1] > y) && x < a[0] + (y - a[1]) * (b[0] - a[0]) / (b[1] - a[1])) {
+                inside = !inside;
+            }
+        }
+        return inside;
+    }
+};
+
+// --transform: a rotation, uniform scale and translation from the input frame
+// to the output frame. The rotation is applied to positions, orientations and
+// SH bands 1-3 as splats are read; the scale and translation are not baked in
+// but written to meta.lcc (scale, offset) so georeferenced output keeps double
+// precision and cell sizes stay in input units
+struct SplatTransform {
+    float rotation[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+    Quat rotation_quat;            // Same rotation (w, x, y, z)
+    float sh_band1[3][3] = {};     // Wigner matrices of the rotation for real SH
+    float sh_band2[5][5] = {};     // bands 1-3 in the 3DGS basis order
+    float sh_band3[7][7] = {};
+    double scale = 1.0;
+    double translation[3] = {0.0, 0.0, 0.0};
+
+    bool rotates() const {
+        return rotation[0][0] != 1.0f || rotation[1][1] != 1.0f || rotation[2][2] != 1.0f ||
+               rotation[0][1] != 0.0f || rotation[0][2] != 0.0f || rotation[1][0] != 0.0f ||
+               rotation[1][2] != 0.0f || rotation[2][0] != 0.0f || rotation[2][1] != 0.0f;
+    }
+    bool enabled() const {
+        return rotates() || scale != 1.0 || translation[0] != 0.0 || translation[1] != 0.0 ||
+               translation[2] != 0.0;
+    }
+
+    Vec3f apply_pos(const Vec3f& p) const {
+        return Vec3f(rotation[0][0] * p.x + rotation[0][1] * p.y + rotation[0][2] * p.z,
+                     rotation[1][0] * p.x + rotation[1][1] * p.y + rotation[1][2] * p.z,
+                     rotation[2][0] * p.x + rotation[2][1] * p.y + rotation[2][2] * p.z);
+    }
+
+    // Rotation composed after the splat's own orientation
+    Quat apply_rot(const Quat& q) const {
+        const Quat& r = rotation_quat;
+        return Quat(r.w * q.w - r.x * q.x - r.y * q.y - r.z * q.z,
+                    r.w * q.x + r.x * q.w + r.y * q.z - r.z * q.y,
+                    r.w * q.y - r.x * q.z + r.y * q.w + r.z * q.x,
+                    r.w * q.z + r.x * q.y - r.y * q.x + r.z * q.w);
+    }
+
+    // Rotate bands 1-3 of f_rest in place (channel-major, num_f_rest / 3
+    // coefficients per channel, as in the PLY); higher bands are left as they are
+    void apply_sh(float* f_rest, int num_f_rest) const;
+
+    // From a row-major 4x4 matrix; throws std::runtime_error unless the upper
+    // 3x3 is a proper rotation times a positive uniform scale and the bottom
+    // row is (0, 0, 0, 1)
+    static SplatTransform from_matrix(const double m[16]);
+};
+
+// --cell-size auto: choose the square cell size from LOD0 density so the
+// percentile-th cell holds about splats_per_cell (or bytes_per_cell) splats
+struct AutoCellSize {
+    bool enabled = false;
+    size_t splats_per_cell = 100000;
+    uint64_t bytes_per_cell = 0;    // data.bin + shcoef.bin bytes; overrides splats_per_cell
+    float percentile = 90.0f;       // over non-empty cells
+    size_t sample_size = 1 << 18;   // LOD0 rows sampled
+};
+
+// Splits a large scene into square super-tiles on a fixed x/y lattice from the
+// LOD0 bbox corner; each tile is converted as an independent LCC scene
+struct Tiling {
+    float tile_size = 0.0f;  // meters (0 = derive from max_splats)
+    size_t max_splats = 0;   // LOD0 splats the densest tile may hold
+
+    bool enabled() const { return tile_size > 0.0f || max_splats > 0; }
+};
+
+// Clips the bbox and the scale/SH quantisation ranges at percentiles so a few
+// outliers do not set them for the whole scene (0 keeps the full range).
+// Splats outside the clipped bbox go to the nearest edge cell; attributes
+// outside the clipped ranges saturate when quantised.
+struct RobustRanges {
+    float bbox_percentile = 0.0f;   // e.g. 99.99 keeps the 0.01%..99.99% position range per axis
+    float range_percentile = 0.0f;  // Same for linear scale and SH coefficients
+
+    bool clips_bbox() const { return bbox_percentile > 0.0f; }
+    bool clips_ranges() const { return range_percentile > 0.0f; }
+    static double tail(float percentile) { return 1.0 - static_cast<double>(percentile) / 100.0; }
+};
+
+// Result of EnvSeparation: the core sphere and the LOD0 rows outside it
+struct EnvironmentSplit {
+    Vec3f center;
+    float radius = 0.0f;
+    std::vector<size_t> rows;  // ascending
+    size_t dropped = 0;        // far splats of LOD1+
+};
+
+// How SH-bearing inputs are encoded
+enum class ShMode {
+    Keep,     // Quality whenever the input has f_rest (default)
+    Analyze,  // Keep, but report the measured SH energy and a recommendation
+    Auto,     // Portable when the measured SH energy is below the threshold
+    Drop      // Always Portable
 };
 
 struct ConvertConfig {
@@ -187,6 +437,7 @@ struct ConvertConfig {
     std::filesystem::path output_dir;
     float cell_size_x = 30.0f;
     float cell_size_y = 30.0f;
+    AutoCellSize auto_cell_size;         // Overrides cell_size_x/y when enabled
     bool single_lod = false;
     bool include_env = true;
     std::filesystem::path env_path;
@@ -194,6 +445,32 @@ struct ConvertConfig {
     std::filesystem::path collision_path;
     bool include_poses = false;
     std::filesystem::path poses_path;
+    bool use_grid_cache = false;
+    bool incremental = false;
+    bool scatter_encode = false;
+    int prefetch_distance = 8;
+    bool stage_rows = false;
+    SplatOrder splat_order = SplatOrder::Input;
+    CellLayout cell_layout = CellLayout::Column;
+    bool lod_major = false;
+    int lod_levels = 0;                  // Generate LOD1..N from LOD0 (0 = use input LOD files)
+    std::vector<size_t> lod_budgets;     // Splat budget per generated level (overrides lod_levels)
+    SplatFilter prune;
+    FloaterFilter floaters;
+    EnvSeparation env_separation;
+    RobustRanges robust;
+    float layer_height = 0.0f;           // Split into z-layer sub-scenes this tall (0 = one scene)
+    Tiling tiling;
+    SplatTransform transform;
+    Region crop;                         // Only splats inside are converted (output coordinates)
+    int workers = 0;                     // Encode in this many worker processes (> 1 enables)
+    std::string worker_launcher;         // Command prefix for each worker
+    std::filesystem::path worker_executable;  // ply2lcc command-line program the workers run
+    int threads = 0;                     // OpenMP threads per process (0 = all cores)
+    size_t max_splats = 0;               // Splat budget over all LODs (0 = unlimited)
+    uint64_t target_size = 0;            // Estimated data.bin + shcoef.bin budget in bytes (0 = unlimited)
+    ShMode sh_mode = ShMode::Keep;
+    float sh_threshold = 0.1f;           // ShEnergy::total_ratio() below which Auto picks Portable
 };
 
 // Utility functions
@@ -1,7 +1,9 @@
 #include <gtest/gtest.h>
 #include "compression.hpp"
+#include "splat_buffer.hpp"
 #include "types.hpp"
 #include <cmath>
+#include <vector>
 
 using namespace ply2lcc;
 
@@ -158,3 +160,41 @@ TEST(CompressionTest, EncodeSHTripletRangeZero) {
     EXPECT_NEAR(g, 512, 1);
     EXPECT_NEAR(b, 1024, 1);
 }
+
+TEST(CompressionTest, EncodeSplatViewInPlaceMatchesAppend) {
+    // Row layout: x y z | f_dc[3] | f_rest[45] | opacity | scale[3] | rot[4]
+    float row[3 + 3 + 45 + 1 + 3 + 4];
+    for (size_t i = 0; i < sizeof(row) / sizeof(float); ++i) {
+        row[i] = 0.1f * static_cast<float>(i) - 2.0f;
+    }
+
+    PropTable table{};
+    table.pos = 0;
+    table.f_dc = 12;
+    table.f_rest = 24;
+    table.opacity = 204;
+    table.scale = 208;
+    table.rot = 220;
+    table.row_stride = sizeof(row);
+    table.num_rows = 1;
+    table.num_f_rest = 45;
+    table.sh_degree = 3;
+
+    AttributeRanges ranges;
+    ranges.expand_scale(Vec3f(0.0f, 0.0f, 0.0f));
+    ranges.expand_scale(Vec3f(1.0f, 1.0f, 1.0f));
+    ranges.expand_sh(-3.0f, -3.0f, -3.0f);
+    ranges.expand_sh(3.0f, 3.0f, 3.0f);
+
+    SplatView sv(reinterpret_cast<const uint8_t*>(row), table);
+
+    std::vector<uint8_t> data_buf, sh_buf;
+    encode_splat_view(sv, data_buf, sh_buf, ranges, true);
+    ASSERT_EQ(data_buf.size(), 32u);
+    ASSERT_EQ(sh_buf.size(), 64u);
+
+    uint8_t data_out[32], sh_out[64];
+    encode_splat_view(sv, data_out, sh_out, ranges, true);
+    EXPECT_EQ(std::vector<uint8_t>(data_out, data_out + 32), data_buf);
+    EXPECT_EQ(std::vector<uint8_t>(sh_out, sh_out + 64), sh_buf);
+}
@@ -0,0 +1,158 @@
+#include <gtest/gtest.h>
+#include "lod_builder.hpp"
+#include "splat_buffer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+using namespace ply2lcc;
+
+// Append one splat row (no f_rest) with identity rotation and isotropic scale
+static void push_splat(SplatRows& rows, float x, float y, float z, float sigma, float alpha, float dc) {
+    float r[14] = {x, y, z, dc, dc, dc, std::log(alpha / (1.0f - alpha)),
+                   std::log(sigma), std::log(sigma), std::log(sigma), 1.0f, 0.0f, 0.0f, 0.0f};
+    rows.values.insert(rows.values.end(), r, r + 14);
+}
+
+TEST(LodBuilderTest, MergePairMatchesMoments) {
+    SplatRows rows;
+    push_splat(rows, 0.0f, 0.0f, 0.0f, 0.1f, 0.5f, 0.2f);
+    push_splat(rows, 1.0f, 0.0f, 0.0f, 0.1f, 0.5f, 0.6f);
+
+    SplatRows merged = merge_to_budget(rows, 1);
+    ASSERT_EQ(merged.size(), 1u);
+    const float* m = merged.row(0);
+
+    EXPECT_NEAR(m[0], 0.5f, 1e-5f);
+    EXPECT_NEAR(m[1], 0.0f, 1e-5f);
+    EXPECT_NEAR(m[3], 0.4f, 1e-5f);
+
+    // Variance along x: sigma^2 + (d/2)^2
+    float s[3] = {std::exp(m[7]), std::exp(m[8]), std::exp(m[9])};
+    std::sort(s, s + 3);
+    EXPECT_NEAR(s[0], 0.1f, 1e-4f);
+    EXPECT_NEAR(s[1], 0.1f, 1e-4f);
+    EXPECT_NEAR(s[2], std::sqrt(0.26f), 1e-4f);
+
+    // The long axis is rotated onto x
+    int long_axis = static_cast<int>(std::max_element(m + 7, m + 10) - (m + 7));
+    float w = m[10], x = m[11], y = m[12], z = m[13];
+    float axis[3][3] = {{1 - 2 * (y * y + z * z), 2 * (x * y + w * z), 2 * (x * z - w * y)},
+                        {2 * (x * y - w * z), 1 - 2 * (x * x + z * z), 2 * (y * z + w * x)},
+                        {2 * (x * z + w * y), 2 * (y * z - w * x), 1 - 2 * (x * x + y * y)}};
+    EXPECT_NEAR(std::abs(axis[long_axis][0]), 1.0f, 1e-4f);
+
+    // Opacity-area mass is conserved: 2 * 0.5 * 0.1^2 = alpha * 0.1 * sqrt(0.26)
+    float alpha = 1.0f / (1.0f + std::exp(-m[6]));
+    EXPECT_NEAR(alpha, 0.01f / (0.1f * std::sqrt(0.26f)), 1e-4f);
+}
+
+TEST(LodBuilderTest, MergeRespectsBudget) {
+    SplatRows rows;
+    for (int i = 0; i < 40; ++i) {
+        for (int j = 0; j < 40; ++j) {
+            push_splat(rows, 0.1f * static_cast<float>(i), 0.1f * static_cast<float>(j), 0.0f, 0.02f, 0.8f, 0.0f);
+        }
+    }
+
+    for (size_t budget : {1000u, 400u, 100u, 7u, 1u}) {
+        SplatRows merged = merge_to_budget(rows, budget);
+        EXPECT_LE(merged.size(), budget);
+        EXPECT_GE(merged.size(), budget / 4);
+    }
+
+    // Under budget: unchanged
+    SplatRows same = merge_to_budget(rows, 5000);
+    EXPECT_EQ(same.values, rows.values);
+}
+
+TEST(LodBuilderTest, DefaultBudgetsQuarterEachLevel) {
+    EXPECT_EQ(LodBuilder::default_budgets(1000, 3), (std::vector<size_t>{250, 62, 15}));
+    EXPECT_EQ(LodBuilder::default_budgets(3, 2), (std::vector<size_t>{1, 1}));
+}
+
+// Write a binary Gaussian splatting PLY with SH degree 1 (9 f_rest)
+static void write_test_ply(const fs::path& path, const std::vector<Splat>& splats) {
+    std::ofstream out(path, std::ios::binary);
+    out << "ply\nformat binary_little_endian 1.0\n"
+        << "element vertex " << splats.size() << "\n"
+        << "property float x\nproperty float y\nproperty float z\n"
+        << "property float f_dc_0\nproperty float f_dc_1\nproperty float f_dc_2\n";
+    for (int i = 0; i < 9; ++i) out << "property float f_rest_" << i << "\n";
+    out << "property float opacity\n"
+        << "property float scale_0\nproperty float scale_1\nproperty float scale_2\n"
+        << "property float rot_0\nproperty float rot_1\nproperty float rot_2\nproperty float rot_3\n"
+        << "end_header\n";
+    for (const auto& s : splats) {
+        out.write(reinterpret_cast<const char*>(&s.pos), 12);
+        out.write(reinterpret_cast<const char*>(s.f_dc), 12);
+        out.write(reinterpret_cast<const char*>(s.f_rest), 9 * sizeof(float));
+        out.write(reinterpret_cast<const char*>(&s.opacity), 4);
+        out.write(reinterpret_cast<const char*>(&s.scale), 12);
+        out.write(reinterpret_cast<const char*>(s.rot), 16);
+    }
+}
+
+TEST(LodBuilderTest, BuildWritesLevelsIntoGrid) {
+    const fs::path dir = fs::temp_directory_path() / "ply2lcc_lod_builder_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+
+    // Two 10 m cells: 300 splats in the first, 100 in the second
+    std::vector<Splat> splats;
+    for (int i = 0; i < 400; ++i) {
+        Splat s{};
+        const float t = static_cast<float>(i % 100);
+        s.pos = Vec3f(i < 300 ? 0.1f * t : 10.0f + 0.1f * t, 0.05f * static_cast<float>(i % 37), 0.01f * t);
+        s.opacity = 1.0f;
+        s.scale = Vec3f(-3.0f, -3.0f, -3.0f);
+        s.rot[0] = 1.0f;
+        splats.push_back(s);
+    }
+    const fs::path ply = dir / "point_cloud.ply";
+    write_test_ply(ply, splats);
+
+    SpatialGrid grid = SpatialGrid::from_files({ply}, 10.0f, 10.0f);
+    ASSERT_EQ(grid.cells().size(), 2u);
+    const BBox lod0_bbox = grid.bbox();
+
+    LodBuilder builder({100, 25});
+    auto files = builder.build(grid, ply, dir / "lods");
+    ASSERT_EQ(files.size(), 2u);
+    EXPECT_EQ(files[0], dir / "lods" / "lod_1.ply");
+    ASSERT_EQ(grid.num_lods(), 3u);
+
+    for (size_t k = 0; k < files.size(); ++k) {
+        SplatBuffer level;
+        ASSERT_TRUE(level.initialize(files[k])) << level.error();
+        EXPECT_EQ(level.num_f_rest(), 9);
+
+        // Every written row is indexed by exactly one cell, within the level budget
+        std::vector<size_t> rows;
+        for (const auto& [id, cell] : grid.cells()) {
+            for (size_t row : cell.splat_indices[k + 1]) {
+                rows.push_back(row);
+                // Merged positions are weighted means, so they stay in the cell they came from
+                const Vec3f p = level[row].pos();
+                EXPECT_EQ(grid.compute_cell_index(p), id);
+                EXPECT_GE(p.x, lod0_bbox.min.x);
+                EXPECT_LE(p.x, lod0_bbox.max.x);
+                EXPECT_GE(p.y, lod0_bbox.min.y);
+                EXPECT_LE(p.y, lod0_bbox.max.y);
+            }
+        }
+        std::sort(rows.begin(), rows.end());
+        EXPECT_EQ(rows.size(), level.size());
+        for (size_t i = 0; i < rows.size(); ++i) EXPECT_EQ(rows[i], i);
+        EXPECT_LE(level.size(), k == 0 ? 100u : 25u);
+        EXPECT_GE(level.size(), 2u);  // Every cell keeps at least one splat
+    }
+    // Cells keep their LOD0 share: the dense cell gets more of each level
+    const auto& dense = grid.cells().begin()->second;
+    const auto& sparse = std::next(grid.cells().begin())->second;
+    EXPECT_GT(dense.splat_indices[1].size(), sparse.splat_indices[1].size());
+
+    fs::remove_all(dir);
+}
@@ -96,6 +96,20 @@ TEST_F(PlatformTest, Fopen) {
     fclose(f);
 }
 
+TEST_F(PlatformTest, SpawnProcessExitCode) {
+#ifdef _WIN32
+    auto p = platform::spawn_process({"cmd", "/c", "exit 3"});
+#else
+    auto p = platform::spawn_process({"sh", "-c", "exit 3"});
+#endif
+    ASSERT_TRUE(p.valid());
+    EXPECT_EQ(platform::wait_process(p), 3);
+    EXPECT_FALSE(p.valid());
+
+    auto missing = platform::spawn_process({"ply2lcc-no-such-program"});
+    EXPECT_NE(platform::wait_process(missing), 0);  // Not started, or exec failed in the child
+}
+
 // Unicode path tests - verify Korean/CJK characters work on all platforms
 class UnicodePlatformTest : public ::testing::Test {
 protected:
@@ -0,0 +1,892 @@
+#include <gtest/gtest.h>
+#include "spatial_grid.hpp"
+#include "grid_encoder.hpp"
+#include "lcc_writer.hpp"
+#include "splat_buffer.hpp"
+#include "splat_order.hpp"
+#include "floater_filter.hpp"
+#include "rate_control.hpp"
+#include "cell_size_tuner.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace ply2lcc;
+
+// Write a minimal binary Gaussian splatting PLY (no normals, SH degree 1)
+static void write_test_ply(const fs::path& path, const std::vector<Splat>& splats) {
+    std::ofstream out(path, std::ios::binary);
+    out << "ply\nformat binary_little_endian 1.0\n"
+        << "element vertex " << splats.size() << "\n"
+        << "property float x\nproperty float y\nproperty float z\n"
+        << "property float f_dc_0\nproperty float f_dc_1\nproperty float f_dc_2\n";
+    for (int i = 0; i < 9; ++i) out << "property float f_rest_" << i << "\n";
+    out << "property float opacity\n"
+        << "property float scale_0\nproperty float scale_1\nproperty float scale_2\n"
+        << "property float rot_0\nproperty float rot_1\nproperty float rot_2\nproperty float rot_3\n"
+        << "end_header\n";
+
+    for (const auto& s : splats) {
+        out.write(reinterpret_cast<const char*>(&s.pos), 12);
+        out.write(reinterpret_cast<const char*>(s.f_dc), 12);
+        out.write(reinterpret_cast<const char*>(s.f_rest), 9 * sizeof(float));
+        out.write(reinterpret_cast<const char*>(&s.opacity), 4);
+        out.write(reinterpret_cast<const char*>(&s.scale), 12);
+        out.write(reinterpret_cast<const char*>(s.rot), 16);
+    }
+}
+
+static Splat make_splat(float x, float y, float z) {
+    Splat s{};
+    s.pos = Vec3f(x, y, z);
+    s.opacity = 2.0f;
+    s.scale = Vec3f(-3.0f, -3.0f, -3.0f);
+    s.rot[0] = 1.0f;
+    for (int i = 0; i < 9; ++i) s.f_rest[i] = 0.01f * static_cast<float>(i);
+    return s;
+}
+
+class SpatialGridTest : public ::testing::Test {
+protected:
+    fs::path dir_;
+    fs::path ply_;
+
+    void SetUp() override {
+        dir_ = fs::temp_directory_path() /
+               ("ply2lcc_grid_test_" + std::string(::testing::UnitTest::GetInstance()->current_test_info()->name()));
+        fs::create_directories(dir_);
+        ply_ = dir_ / "point_cloud.ply";
+
+        std::vector<Splat> splats;
+        for (int i = 0; i < 200; ++i) {
+            float t = static_cast<float>(i);
+            splats.push_back(make_splat(t * 0.5f, std::fmod(t * 7.0f, 90.0f), t * 0.01f));
+        }
+        write_test_ply(ply_, splats);
+    }
+
+    void TearDown() override {
+        fs::remove_all(dir_);
+    }
+};
+
+TEST_F(SpatialGridTest, FromFilesAssignsEverySplat) {
+    SpatialGrid grid = SpatialGrid::from_files({ply_}, 30.0f, 30.0f);
+
+    size_t total = 0;
+    for (const auto& [id, cell] : grid.cells()) {
+        total += cell.splat_indices[0].size();
+    }
+    EXPECT_EQ(total, 200u);
+    EXPECT_TRUE(grid.has_sh());
+    EXPECT_EQ(grid.sh_degree(), 1);
+}
+
+TEST_F(SpatialGridTest, BatchCellIndicesMatchScalar) {
+    SpatialGrid grid = SpatialGrid::from_files({ply_}, 7.0f, 3.0f);
+    const BBox& bbox = grid.bbox();
+
+    std::vector<float> xs, ys;
+    for (int i = 0; i <= 200; ++i) {
+        float t = static_cast<float>(i) / 200.0f;
+        xs.push_back(bbox.min.x + t * (bbox.max.x - bbox.min.x));
+        ys.push_back(bbox.max.y - t * (bbox.max.y - bbox.min.y));
+    }
+    // Cell boundaries, outside the bbox and NaN
+    xs.insert(xs.end(), {bbox.min.x + 7.0f, bbox.min.x - 50.0f, bbox.max.x + 1e9f, std::nanf("")});
+    ys.insert(ys.end(), {bbox.min.y + 3.0f, bbox.max.y + 50.0f, bbox.min.y - 1e9f, bbox.min.y});
+
+    std::vector<uint32_t> ids(xs.size());
+    grid.compute_cell_indices(xs.data(), ys.data(), xs.size(), ids.data());
+    for (size_t i = 0; i < xs.size(); ++i) {
+        EXPECT_EQ(ids[i], grid.compute_cell_index(Vec3f(xs[i], ys[i], 0.0f))) << i;
+    }
+    EXPECT_EQ(ids[201], (1u << 16) | 1u);
+    EXPECT_EQ(ids[204] & 0xFFFFu, 0u);
+
+    // Binned rows stay in input order within each cell
+    for (const auto& [id, cell] : grid.cells()) {
+        EXPECT_TRUE(std::is_sorted(cell.splat_indices[0].begin(), cell.splat_indices[0].end()));
+    }
+}
+
+TEST_F(SpatialGridTest, MergeAppendsRunsInThreadOrder) {
+    SpatialGrid grid = SpatialGrid::from_files({ply_}, 30.0f, 30.0f);
+    const uint32_t first = grid.cells().begin()->first;
+    const size_t before = grid.cells().begin()->second.splat_indices[0].size();
+    const uint32_t fresh = 0x00200020;
+    ASSERT_EQ(grid.cells().count(fresh), 0u);
+
+    // Two threads' sorted (cell id, row) runs; the second thread holds later rows
+    std::vector<ThreadLocalGrid> locals(2);
+    locals[0].cell_ids = {first, fresh};
+    locals[0].rows = {1000, 1001};
+    locals[1].cell_ids = {first, first, fresh};
+    locals[1].rows = {2000, 2001, 2002};
+    grid.merge(locals, 0);
+
+    const auto& rows = grid.cells().at(first).splat_indices[0];
+    ASSERT_EQ(rows.size(), before + 3);
+    EXPECT_EQ(std::vector<size_t>(rows.end() - 3, rows.end()), (std::vector<size_t>{1000, 2000, 2001}));
+    EXPECT_EQ(grid.cells().at(fresh).splat_indices[0], (std::vector<size_t>{1001, 2002}));
+}
+
+TEST_F(SpatialGridTest, CacheRoundTrip) {
+    SpatialGrid grid = SpatialGrid::from_files({ply_}, 30.0f, 30.0f);
+    std::string key = SpatialGrid::cache_key({ply_}, 30.0f, 30.0f);
+    fs::path cache = dir_ / "grid.cache";
+
+    ASSERT_TRUE(grid.save(cache, key));
+    auto loaded = SpatialGrid::load(cache, key, 1);
+    ASSERT_TRUE(loaded.has_value());
+
+    EXPECT_EQ(loaded->num_lods(), grid.num_lods());
+    EXPECT_EQ(loaded->has_sh(), grid.has_sh());
+    EXPECT_EQ(loaded->num_f_rest(), grid.num_f_rest());
+    EXPECT_FLOAT_EQ(loaded->bbox().min.x, grid.bbox().min.x);
+    EXPECT_FLOAT_EQ(loaded->bbox().max.y, grid.bbox().max.y);
+    EXPECT_FLOAT_EQ(loaded->ranges().scale_max.x, grid.ranges().scale_max.x);
+    EXPECT_FLOAT_EQ(loaded->ranges().sh_min.z, grid.ranges().sh_min.z);
+
+    ASSERT_EQ(loaded->cells().size(), grid.cells().size());
+    for (const auto& [id, cell] : grid.cells()) {
+        auto it = loaded->cells().find(id);
+        ASSERT_NE(it, loaded->cells().end());
+        EXPECT_EQ(it->second.splat_indices, cell.splat_indices);
+    }
+}
+
+TEST_F(SpatialGridTest, CacheRejectsDifferentKey) {
+    SpatialGrid grid = SpatialGrid::from_files({ply_}, 30.0f, 30.0f);
+    fs::path cache = dir_ / "grid.cache";
+    ASSERT_TRUE(grid.save(cache, SpatialGrid::cache_key({ply_}, 30.0f, 30.0f)));
+
+    // Different cell size must not reuse the cached grid
+    EXPECT_FALSE(SpatialGrid::load(cache, SpatialGrid::cache_key({ply_}, 20.0f, 30.0f), 1).has_value());
+    EXPECT_FALSE(SpatialGrid::load(dir_ / "missing.cache", "", 1).has_value());
+}
+
+TEST_F(SpatialGridTest, CacheRejectsCorruptFile) {
+    SpatialGrid grid = SpatialGrid::from_files({ply_}, 30.0f, 30.0f);
+    std::string key = SpatialGrid::cache_key({ply_}, 30.0f, 30.0f);
+    fs::path cache = dir_ / "grid.cache";
+    ASSERT_TRUE(grid.save(cache, key));
+    std::string bytes;
+    {
+        std::ifstream in(cache, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    auto write_cache = [&](const std::string& data) {
+        std::ofstream out(cache, std::ios::binary | std::ios::trunc);
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+    };
+
+    // A grid with another LOD count is not this input's grid
+    EXPECT_FALSE(SpatialGrid::load(cache, key, 2).has_value());
+
+    for (size_t size : {bytes.size() - 1, bytes.size() / 2, size_t(40)}) {
+        write_cache(bytes.substr(0, size));
+        EXPECT_FALSE(SpatialGrid::load(cache, key, 1).has_value()) << "truncated to " << size;
+    }
+
+    // Row count of the first cell, after the header fields and the cell id
+    const size_t first_count = 12 + key.size() + 8 + sizeof(BBox) + sizeof(AttributeRanges) + sizeof(ShEnergy) +
+                               8 + 1 + 4 + 4 + 8 + 4;
+    std::string corrupt = bytes;
+    std::fill(corrupt.begin() + first_count, corrupt.begin() + first_count + 8, '\x7f');
+    write_cache(corrupt);
+    EXPECT_FALSE(SpatialGrid::load(cache, key, 1).has_value());
+
+    corrupt = bytes;
+    std::fill(corrupt.begin() + first_count - 12, corrupt.begin() + first_count - 4, '\x7f');  // Cell count
+    write_cache(corrupt);
+    EXPECT_FALSE(SpatialGrid::load(cache, key, 1).has_value());
+
+    write_cache(bytes);
+    EXPECT_TRUE(SpatialGrid::load(cache, key, 1).has_value());
+}
+
+// Encode `grid` and write it to `out`; returns the bytes of data.bin, shcoef.bin and index.bin
+static std::vector<std::string> encode_files(GridEncoder& encoder, const SpatialGrid& grid,
+                                             const std::vector<fs::path>& lod_files, const fs::path& out) {
+    LccWriter(out).write(encoder.encode(grid, lod_files));
+    std::vector<std::string> files;
+    for (const char* name : {"data.bin", "shcoef.bin", "index.bin"}) {
+        std::ifstream in(out / name, std::ios::binary);
+        files.emplace_back(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    return files;
+}
+
+// Two LODs over several cells, with rows of each cell spread through the file
+class EncodePathTest : public SpatialGridTest {
+protected:
+    std::vector<fs::path> lods_;
+    std::optional<SpatialGrid> grid_;
+
+    void SetUp() override {
+        SpatialGridTest::SetUp();
+        std::vector<Splat> coarse;
+        for (int i = 0; i < 50; ++i) {
+            Splat s = make_splat(static_cast<float>(i) * 2.0f, std::fmod(static_cast<float>(i) * 13.0f, 90.0f), 0.0f);
+            s.f_dc[0] = 0.02f * static_cast<float>(i);
+            coarse.push_back(s);
+        }
+        write_test_ply(dir_ / "point_cloud_1.ply", coarse);
+        lods_ = {ply_, dir_ / "point_cloud_1.ply"};
+        grid_ = SpatialGrid::from_files(lods_, 30.0f, 30.0f);
+        ASSERT_GT(grid_->cells().size(), 4u);
+    }
+};
+
+TEST_F(EncodePathTest, ScatterMatchesGather) {
+    GridEncoder gather;
+    GridEncoder scatter;
+    scatter.set_scatter(true);
+    const auto a = encode_files(gather, *grid_, lods_, dir_ / "gather");
+    const auto b = encode_files(scatter, *grid_, lods_, dir_ / "scatter");
+    ASSERT_FALSE(a[0].empty());
+    ASSERT_FALSE(a[1].empty());
+    EXPECT_TRUE(a[0] == b[0]) << "data.bin differs";
+    EXPECT_TRUE(a[1] == b[1]) << "shcoef.bin differs";
+    EXPECT_TRUE(a[2] == b[2]) << "index.bin differs";
+}
+
+TEST_F(EncodePathTest, StagingAndPrefetchDoNotChangeOutput) {
+    GridEncoder plain;
+    plain.set_prefetch_distance(0);
+    const auto reference = encode_files(plain, *grid_, lods_, dir_ / "plain");
+    ASSERT_FALSE(reference[0].empty());
+
+    int variant = 0;
+    for (bool stage : {false, true}) {
+        for (int prefetch : {1, 8, 1000}) {  // 1000 runs past the end of every cell
+            GridEncoder encoder;
+            encoder.set_stage_rows(stage);
+            encoder.set_prefetch_distance(prefetch);
+            const auto out = encode_files(encoder, *grid_, lods_, dir_ / ("variant_" + std::to_string(variant++)));
+            EXPECT_TRUE(out == reference) << "stage_rows " << stage << ", prefetch " << prefetch;
+        }
+    }
+}
+
+TEST_F(SpatialGridTest, StatsSweepSkipsNonFinitePositions) {
+    std::vector<Splat> splats;
+    for (int i = 0; i < 2500; ++i) {  // Spans several position blocks
+        splats.push_back(make_splat(static_cast<float>(i % 37), -static_cast<float>(i % 11), 0.5f * static_cast<float>(i % 5)));
+    }
+    splats[10].pos.x = std::nanf("");
+    splats[2049].pos.z = -std::numeric_limits<float>::infinity();
+    fs::path ply = dir_ / "stats.ply";
+    write_test_ply(ply, splats);
+
+    SplatBuffer buffer;
+    ASSERT_TRUE(buffer.initialize(ply));
+    SplatStats stats = buffer.compute_stats();
+    EXPECT_EQ(stats.non_finite, 2u);
+    EXPECT_FLOAT_EQ(stats.bbox.min.x, 0.0f);
+    EXPECT_FLOAT_EQ(stats.bbox.max.x, 36.0f);
+    EXPECT_FLOAT_EQ(stats.bbox.min.y, -10.0f);
+    EXPECT_FLOAT_EQ(stats.bbox.max.y, 0.0f);
+    EXPECT_FLOAT_EQ(stats.bbox.min.z, 0.0f);
+    EXPECT_FLOAT_EQ(stats.bbox.max.z, 2.0f);
+
+    SpatialGrid grid = SpatialGrid::from_files({ply}, 30.0f, 30.0f);
+    EXPECT_EQ(grid.non_finite_positions(), 2u);
+    EXPECT_FLOAT_EQ(grid.bbox().min.z, 0.0f);
+
+    // The filtered sweep counts them too
+    SplatFilter filter;
+    filter.min_opacity = 1.0f / 255.0f;
+    RobustRanges robust;
+    robust.bbox_percentile = 99.0f;
+    SpatialGrid pruned = SpatialGrid::from_files({ply}, 30.0f, 30.0f, filter);
+    EXPECT_EQ(pruned.non_finite_positions(), 2u);
+    SpatialGrid clipped = SpatialGrid::from_files({ply}, 30.0f, 30.0f, {}, {}, robust);
+    EXPECT_EQ(clipped.non_finite_positions(), 2u);
+    EXPECT_TRUE(std::isfinite(clipped.bbox().min.z));
+}
+
+TEST_F(SpatialGridTest, ShardedInputMatchesSingleFile) {
+    std::vector<Splat> splats;
+    for (int i = 0; i < 900; ++i) {
+        splats.push_back(make_splat(static_cast<float>(i % 97), static_cast<float>(i % 41), 0.1f * static_cast<float>(i % 7)));
+    }
+    fs::path whole = dir_ / "cloud.ply";
+    write_test_ply(whole, splats);
+    write_test_ply(dir_ / "cloud_part0.ply", {splats.begin(), splats.begin() + 400});
+    write_test_ply(dir_ / "cloud_part1.ply", {splats.begin() + 400, splats.begin() + 401});
+    write_test_ply(dir_ / "cloud_part2.ply", {splats.begin() + 401, splats.end()});
+    write_test_ply(dir_ / "cloud_part4.ply", {splats.begin(), splats.begin() + 10});  // After a gap: ignored
+
+    EXPECT_EQ(SplatBuffer::shard_paths(whole).size(), 1u);
+    ASSERT_EQ(SplatBuffer::shard_paths(dir_ / "cloud_part0.ply").size(), 3u);
+
+    SplatBuffer buffer;
+    ASSERT_TRUE(buffer.initialize(dir_ / "cloud_part0.ply")) << buffer.error();
+    ASSERT_EQ(buffer.size(), splats.size());
+    EXPECT_EQ(buffer.num_shards(), 3u);
+    for (size_t i : {size_t(0), size_t(399), size_t(400), size_t(401), size_t(899)}) {
+        EXPECT_EQ(buffer.pos(i).x, splats[i].pos.x);
+        EXPECT_EQ(buffer.pos(i).y, splats[i].pos.y);
+    }
+    EXPECT_EQ(buffer.end() - buffer.begin(), 900);
+    EXPECT_FLOAT_EQ(buffer.compute_bbox().max.x, 96.0f);
+
+    SpatialGrid a = SpatialGrid::from_files({whole}, 10.0f, 10.0f);
+    SpatialGrid b = SpatialGrid::from_files({dir_ / "cloud_part0.ply"}, 10.0f, 10.0f);
+    ASSERT_EQ(a.cells().size(), b.cells().size());
+    for (const auto& [id, cell] : a.cells()) {
+        ASSERT_TRUE(b.cells().count(id));
+        EXPECT_EQ(cell.splat_indices[0], b.cells().at(id).splat_indices[0]);
+    }
+}
+
+TEST_F(SpatialGridTest, TransformRotatesGridFrame) {
+    // Y-up to Z-up: +90 degrees about x
+    const double y_up[16] = {1, 0, 0, 100, 0, 0, -1, 0, 0, 1, 0, 0, 0, 0, 0, 1};
+    const SplatTransform transform = SplatTransform::from_matrix(y_up);
+    SpatialGrid raw = SpatialGrid::from_files({ply_}, 30.0f, 30.0f);
+    SpatialGrid grid = SpatialGrid::from_files({ply_}, 30.0f, 30.0f, {}, {}, {}, {}, transform);
+
+    // Binned in the rotated frame; the translation is left to meta.lcc
+    EXPECT_FLOAT_EQ(grid.bbox().min.x, raw.bbox().min.x);
+    EXPECT_FLOAT_EQ(grid.bbox().min.z, raw.bbox().min.y);
+    EXPECT_FLOAT_EQ(grid.bbox().max.z, raw.bbox().max.y);
+    EXPECT_FLOAT_EQ(grid.bbox().min.y, -raw.bbox().max.z);
+    EXPECT_TRUE(grid.transform().rotates());
+    EXPECT_NE(SpatialGrid::cache_key({ply_}, 30.0f, 30.0f),
+              SpatialGrid::cache_key({ply_}, 30.0f, 30.0f, {}, {}, {}, {}, transform));
+
+    // Views read through the grid's transform see rotated positions and SH
+    SplatBuffer buffer;
+    ASSERT_TRUE(buffer.initialize(ply_, &grid.transform()));
+    SplatBuffer plain;
+    ASSERT_TRUE(plain.initialize(ply_));
+    EXPECT_FLOAT_EQ(buffer.pos(7).z, plain.pos(7).y);
+    float scratch[MAX_F_REST];
+    const float* sh = buffer[7].sh_rest(scratch);
+    EXPECT_NE(sh, &buffer[7].f_rest(0));
+    EXPECT_FLOAT_EQ(sh[2], plain[7].f_rest(2));  // The -x coefficient is unchanged by a turn about x
+    EXPECT_NE(sh[0], plain[7].f_rest(0));
+}
+
+TEST_F(SpatialGridTest, FilterPrunesInvisibleSplats) {
+    std::vector<Splat> splats;
+    for (int i = 0; i < 10; ++i) {
+        splats.push_back(make_splat(static_cast<float>(i), 1.0f, 0.0f));
+    }
+    splats[1].opacity = -8.0f;                          // sigmoid ~ 3e-4
+    splats[2].scale = Vec3f(-9.0f, -8.0f, -10.0f);      // largest axis ~ 0.3 mm
+    splats[3].f_rest[4] = std::nanf("");
+    splats[4].pos.x = std::numeric_limits<float>::infinity();
+    fs::path ply = dir_ / "pruned.ply";
+    write_test_ply(ply, splats);
+
+    SplatFilter filter;
+    filter.min_opacity = 1.0f / 255.0f;
+    filter.min_scale = 0.001f;
+    filter.drop_non_finite = true;
+    SpatialGrid grid = SpatialGrid::from_files({ply}, 30.0f, 30.0f, filter);
+
+    std::vector<size_t> kept;
+    for (const auto& [id, cell] : grid.cells()) {
+        kept.insert(kept.end(), cell.splat_indices[0].begin(), cell.splat_indices[0].end());
+    }
+    std::sort(kept.begin(), kept.end());
+    EXPECT_EQ(kept, (std::vector<size_t>{0, 5, 6, 7, 8, 9}));
+
+    ASSERT_EQ(grid.prune_stats().size(), 1u);
+    EXPECT_EQ(grid.prune_stats()[0].non_finite, 2u);
+    EXPECT_EQ(grid.prune_stats()[0].opacity, 1u);
+    EXPECT_EQ(grid.prune_stats()[0].scale, 1u);
+    EXPECT_TRUE(std::isfinite(grid.bbox().max.x));
+    EXPECT_FLOAT_EQ(grid.bbox().max.x, 9.0f);
+
+    // meta.lcc splat counts cover what is encoded, not the input rows
+    LccData data = GridEncoder().encode(grid, {ply});
+    EXPECT_EQ(data.total_splats, 6u);
+    EXPECT_EQ(data.splats_per_lod, (std::vector<size_t>{6}));
+
+    // The filter is part of the cache key
+    std::string key = SpatialGrid::cache_key({ply}, 30.0f, 30.0f, filter);
+    EXPECT_NE(key, SpatialGrid::cache_key({ply}, 30.0f, 30.0f));
+
+    // A cache hit reports the same prune counts as the build
+    ASSERT_TRUE(grid.save(dir_ / "pruned.cache", key));
+    auto loaded = SpatialGrid::load(dir_ / "pruned.cache", key, 1);
+    ASSERT_TRUE(loaded.has_value());
+    ASSERT_EQ(loaded->prune_stats().size(), 1u);
+    EXPECT_EQ(loaded->prune_stats()[0].non_finite, 2u);
+    EXPECT_EQ(loaded->prune_stats()[0].opacity, 1u);
+    EXPECT_EQ(loaded->prune_stats()[0].scale, 1u);
+    EXPECT_EQ(loaded->non_finite_positions(), grid.non_finite_positions());
+}
+
+TEST_F(SpatialGridTest, FarSplatsMoveToEnvironment) {
+    // 10x10 core at 1 m spacing plus three distant sky splats
+    std::vector<Splat> splats;
+    for (int i = 0; i < 10; ++i) {
+        for (int j = 0; j < 10; ++j) {
+            splats.push_back(make_splat(static_cast<float>(i), static_cast<float>(j), 0.0f));
+        }
+    }
+    splats.push_back(make_splat(1000.0f, 0.0f, 0.0f));
+    splats.push_back(make_splat(0.0f, -800.0f, 500.0f));
+    splats.push_back(make_splat(5.0f, 5.0f, 2000.0f));
+    fs::path lod0 = dir_ / "env_lod0.ply";
+    write_test_ply(lod0, splats);
+    fs::path lod1 = dir_ / "env_lod1.ply";
+    write_test_ply(lod1, {make_splat(4.0f, 4.0f, 0.0f), make_splat(-900.0f, 0.0f, 0.0f)});
+
+    EnvSeparation env;
+    env.radius_factor = 3.0f;
+    SpatialGrid grid = SpatialGrid::from_files({lod0, lod1}, 30.0f, 30.0f, {}, env);
+
+    EXPECT_EQ(grid.environment().rows, (std::vector<size_t>{100, 101, 102}));
+    EXPECT_EQ(grid.environment().dropped, 1u);
+    EXPECT_GT(grid.environment().radius, 0.0f);
+    EXPECT_LT(grid.environment().radius, 100.0f);
+    EXPECT_FLOAT_EQ(grid.bbox().min.y, 0.0f);
+    EXPECT_FLOAT_EQ(grid.bbox().max.x, 9.0f);
+    EXPECT_FLOAT_EQ(grid.bbox().max.z, 0.0f);
+
+    size_t lod0_cells = 0;
+    for (const auto& [id, cell] : grid.cells()) {
+        lod0_cells += cell.splat_indices[0].size();
+    }
+    EXPECT_EQ(lod0_cells, 100u);
+
+    // The split survives the cache and is part of its key
+    std::string key = SpatialGrid::cache_key({lod0, lod1}, 30.0f, 30.0f, {}, env);
+    EXPECT_NE(key, SpatialGrid::cache_key({lod0, lod1}, 30.0f, 30.0f));
+    fs::path cache = dir_ / "env_grid.cache";
+    ASSERT_TRUE(grid.save(cache, key));
+    auto loaded = SpatialGrid::load(cache, key, 2);
+    ASSERT_TRUE(loaded.has_value());
+    EXPECT_EQ(loaded->environment().rows, grid.environment().rows);
+    EXPECT_EQ(loaded->environment().dropped, 1u);
+    EXPECT_FLOAT_EQ(loaded->environment().radius, grid.environment().radius);
+
+    // The separated rows are encoded alongside an explicit environment file
+    GridEncoder encoder;
+    EncodedEnvironment encoded = encoder.encode_environment({{lod1, {}}, {lod0, grid.environment().rows}}, false);
+    EXPECT_EQ(encoded.count, 5u);
+    EXPECT_EQ(encoded.data.size(), 5u * 32u);
+    EXPECT_FLOAT_EQ(encoded.bounds.pos_max.z, 2000.0f);
+}
+
+TEST_F(SpatialGridTest, RobustRangesIgnoreOutliers) {
+    // 200 splats along x in [0, 19.9] plus one stray splat far out with a huge scale
+    std::vector<Splat> splats;
+    for (int i = 0; i < 200; ++i) {
+        Splat s = make_splat(0.1f * static_cast<float>(i), 1.0f, 0.0f);
+        s.scale = Vec3f(-3.0f, -3.0f, -3.0f);
+        s.f_rest[0] = 0.01f * static_cast<float>(i % 10);
+        splats.push_back(s);
+    }
+    Splat stray = make_splat(1e6f, 1.0f, 0.0f);
+    stray.scale = Vec3f(8.0f, -3.0f, -3.0f);
+    stray.f_rest[0] = 40.0f;
+    splats.push_back(stray);
+    fs::path ply = dir_ / "robust.ply";
+    write_test_ply(ply, splats);
+
+    SpatialGrid plain = SpatialGrid::from_files({ply}, 30.0f, 30.0f);
+    EXPECT_FLOAT_EQ(plain.bbox().max.x, 1e6f);
+
+    RobustRanges robust;
+    robust.bbox_percentile = 99.0f;
+    robust.range_percentile = 99.0f;
+    SpatialGrid grid = SpatialGrid::from_files({ply}, 30.0f, 30.0f, {}, {}, robust);
+
+    EXPECT_GE(grid.bbox().max.x, 19.9f);
+    EXPECT_LT(grid.bbox().max.x, 21.0f);
+    EXPECT_GE(grid.bbox().min.x, 0.0f);
+    EXPECT_LE(grid.bbox().min.x, 0.2f);  // 1% tail trims the lowest two splats too
+    EXPECT_LT(grid.ranges().scale_max.x, 0.06f);
+    EXPECT_GE(grid.ranges().scale_max.x, std::exp(-3.0f));
+    EXPECT_LT(grid.ranges().sh_max.x, 0.1f);
+
+    // Every splat is still binned; the stray one lands in an edge cell inside the bbox
+    size_t binned = 0;
+    for (const auto& [id, cell] : grid.cells()) {
+        binned += cell.splat_indices[0].size();
+        EXPECT_EQ(id & 0xFFFF, 0u);
+    }
+    EXPECT_EQ(binned, splats.size());
+
+    // Clipping is part of the cache key and survives a round trip
+    std::string key = SpatialGrid::cache_key({ply}, 30.0f, 30.0f, {}, {}, robust);
+    EXPECT_NE(key, SpatialGrid::cache_key({ply}, 30.0f, 30.0f));
+    fs::path cache = dir_ / "robust_grid.cache";
+    ASSERT_TRUE(grid.save(cache, key));
+    auto loaded = SpatialGrid::load(cache, key, 1);
+    ASSERT_TRUE(loaded.has_value());
+    EXPECT_FLOAT_EQ(loaded->ranges().scale_max.x, grid.ranges().scale_max.x);
+}
+
+TEST_F(SpatialGridTest, SplitLayersByHeight) {
+    // Two floors 3 m apart over the same footprint, nothing in between
+    std::vector<Splat> splats;
+    for (int i = 0; i < 10; ++i) {
+        for (float z : {0.2f, 0.8f, 3.1f, 3.9f}) {
+            splats.push_back(make_splat(5.0f * static_cast<float>(i), 10.0f, z));
+        }
+    }
+    fs::path ply = dir_ / "floors.ply";
+    write_test_ply(ply, splats);
+
+    SpatialGrid grid = SpatialGrid::from_files({ply}, 20.0f, 20.0f);
+    auto layers = grid.split_layers({ply}, 2.0f);
+    ASSERT_EQ(layers.size(), 2u);
+    EXPECT_EQ(layers[0].first, 0);
+    EXPECT_EQ(layers[1].first, 1);
+
+    size_t total = 0;
+    for (const auto& [k, layer] : layers) {
+        // Same cells and x/y extent as the parent; z tight to the layer
+        EXPECT_FLOAT_EQ(layer.bbox().min.x, grid.bbox().min.x);
+        EXPECT_FLOAT_EQ(layer.bbox().max.x, grid.bbox().max.x);
+        EXPECT_EQ(layer.cells().size(), grid.cells().size());
+        for (const auto& [id, cell] : layer.cells()) total += cell.splat_indices[0].size();
+    }
+    EXPECT_EQ(total, splats.size());
+    EXPECT_FLOAT_EQ(layers[0].second.bbox().min.z, 0.2f);
+    EXPECT_FLOAT_EQ(layers[0].second.bbox().max.z, 0.8f);
+    EXPECT_FLOAT_EQ(layers[1].second.bbox().min.z, 3.1f);
+    EXPECT_FLOAT_EQ(layers[1].second.bbox().max.z, 3.9f);
+}
+
+TEST_F(SpatialGridTest, RegionsPartitionSplats) {
+    // Splats on a line, some exactly on the tile border at x = 50
+    std::vector<Splat> splats;
+    for (int i = 0; i <= 100; i += 5) {
+        splats.push_back(make_splat(static_cast<float>(i), 0.0f, 0.0f));
+    }
+    fs::path ply = dir_ / "tiles.ply";
+    write_test_ply(ply, splats);
+
+    Region left;
+    left.max_x = 50.0f;
+    Region right;
+    right.min_x = 50.0f;
+    SpatialGrid a = SpatialGrid::from_files({ply}, 10.0f, 10.0f, {}, {}, {}, left);
+    SpatialGrid b = SpatialGrid::from_files({ply}, 10.0f, 10.0f, {}, {}, {}, right);
+
+    auto count = [](const SpatialGrid& grid) {
+        size_t n = 0;
+        for (const auto& [id, cell] : grid.cells()) n += cell.splat_indices[0].size();
+        return n;
+    };
+    EXPECT_EQ(count(a), 10u);
+    EXPECT_EQ(count(b), 11u);
+    EXPECT_FLOAT_EQ(a.bbox().max.x, 45.0f);
+    EXPECT_FLOAT_EQ(b.bbox().min.x, 50.0f);
+    EXPECT_EQ(a.prune_stats()[0].total(), 0u);  // Outside the region is not pruning
+    EXPECT_NE(SpatialGrid::cache_key({ply}, 10.0f, 10.0f, {}, {}, {}, left),
+              SpatialGrid::cache_key({ply}, 10.0f, 10.0f, {}, {}, {}, right));
+}
+
+TEST_F(SpatialGridTest, CropPolygonSkipsOutsideBlocks) {
+    // Rows sweep a 100 x 100 square in file order, so most row blocks lie
+    // wholly outside the small triangle and are skipped after the bbox pass
+    std::vector<Splat> splats;
+    for (int j = 0; j < 100; ++j) {
+        for (int i = 0; i < 100; ++i) {
+            splats.push_back(make_splat(static_cast<float>(i) + 0.5f, static_cast<float>(j) + 0.5f,
+                                        static_cast<float>(i % 3)));
+        }
+    }
+    fs::path ply = dir_ / "crop.ply";
+    write_test_ply(ply, splats);
+
+    Region crop;
+    crop.polygon = {{{20.0f, 40.0f}}, {{60.0f, 40.0f}}, {{20.0f, 80.0f}}};
+    crop.min_x = 20.0f;
+    crop.max_x = 60.0f;
+    crop.min_y = 40.0f;
+    crop.max_y = 80.0f;
+    crop.max_z = 2.0f;
+    SpatialGrid grid = SpatialGrid::from_files({ply}, 10.0f, 10.0f, {}, {}, {}, crop);
+
+    std::vector<size_t> expected;
+    for (size_t row = 0; row < splats.size(); ++row) {
+        if (crop.contains(splats[row].pos)) expected.push_back(row);
+    }
+    std::vector<size_t> rows;
+    for (const auto& [id, cell] : grid.cells()) {
+        rows.insert(rows.end(), cell.splat_indices[0].begin(), cell.splat_indices[0].end());
+    }
+    std::sort(rows.begin(), rows.end());
+    ASSERT_FALSE(expected.empty());
+    EXPECT_EQ(rows, expected);
+    EXPECT_GE(grid.bbox().min.x, 20.0f);
+    EXPECT_LE(grid.bbox().max.y, 80.0f);
+    EXPECT_LT(grid.bbox().max.z, 2.0f);
+    EXPECT_LE(grid.cells().size(), 16u);  // Only cells overlapping the triangle
+
+    Region box = crop;
+    box.polygon.clear();
+    EXPECT_NE(SpatialGrid::cache_key({ply}, 10.0f, 10.0f, {}, {}, {}, crop),
+              SpatialGrid::cache_key({ply}, 10.0f, 10.0f, {}, {}, {}, box));
+}
+
+TEST_F(SpatialGridTest, SubsetKeepsOnlyGivenCells) {
+    std::vector<Splat> splats;
+    for (int i = 0; i < 4; ++i) {
+        splats.push_back(make_splat(10.0f * static_cast<float>(i) + 1.0f, 1.0f, 0.0f));
+    }
+    fs::path ply = dir_ / "subset.ply";
+    write_test_ply(ply, splats);
+
+    SpatialGrid grid = SpatialGrid::from_files({ply}, 10.0f, 10.0f);
+    ASSERT_EQ(grid.cells().size(), 4u);
+    SpatialGrid shard = grid.subset({1u, 3u, 99u});
+    ASSERT_EQ(shard.cells().size(), 2u);
+    EXPECT_EQ(shard.cells().count(1u), 1u);
+    EXPECT_EQ(shard.cells().count(3u), 1u);
+    EXPECT_FLOAT_EQ(shard.bbox().min.x, grid.bbox().min.x);
+    EXPECT_FLOAT_EQ(shard.ranges().scale_max.x, grid.ranges().scale_max.x);
+}
+
+TEST_F(SpatialGridTest, AutoCellSizeHitsTarget) {
+    // 100 x 100 m at 1 splat per m^2
+    std::vector<Splat> splats;
+    for (int i = 0; i < 100; ++i) {
+        for (int j = 0; j < 100; ++j) {
+            splats.push_back(make_splat(0.5f + static_cast<float>(i), 0.5f + static_cast<float>(j), 0.0f));
+        }
+    }
+    fs::path ply = dir_ / "density.ply";
+    write_test_ply(ply, splats);
+
+    AutoCellSize tuning;
+    tuning.enabled = true;
+    tuning.splats_per_cell = 400;
+    CellSizePrediction prediction = tune_cell_size(ply, tuning);
+    EXPECT_EQ(prediction.target, 400u);
+    EXPECT_LE(prediction.at_percentile, 400u);
+    EXPECT_GT(prediction.cell_size, 15.0f);
+    EXPECT_LE(prediction.cell_size, 20.5f);
+
+    // The prediction matches the grid built with that size
+    SpatialGrid grid = SpatialGrid::from_files({ply}, prediction.cell_size, prediction.cell_size);
+    EXPECT_EQ(grid.cells().size(), prediction.cells);
+
+    // Byte targets convert with the output cost per splat (SH: 96 bytes)
+    tuning.bytes_per_cell = 96 * 100;
+    prediction = tune_cell_size(ply, tuning);
+    EXPECT_EQ(prediction.target, 100u);
+    EXPECT_LE(prediction.at_percentile, 100u);
+    EXPECT_GT(prediction.cell_size, 7.5f);
+
+    // Everything fits in one cell
+    tuning.bytes_per_cell = 0;
+    tuning.splats_per_cell = 1000000;
+    prediction = tune_cell_size(ply, tuning);
+    EXPECT_EQ(prediction.cells, 1u);
+    EXPECT_EQ(prediction.max, splats.size());
+}
+
+TEST_F(SpatialGridTest, FloatersAreRemovedAndGridTightens) {
+    // Dense 40x40 sheet spanning two cells, plus three isolated splats
+    std::vector<Splat> splats;
+    for (int i = 0; i < 40; ++i) {
+        for (int j = 0; j < 40; ++j) {
+            splats.push_back(make_splat(25.0f + 0.25f * static_cast<float>(i), 0.25f * static_cast<float>(j), 0.0f));
+        }
+    }
+    splats.push_back(make_splat(26.0f, 2.0f, 20.0f));
+    splats.push_back(make_splat(30.0f, 5.0f, 40.0f));
+    splats.push_back(make_splat(34.0f, 8.0f, -15.0f));
+    fs::path ply = dir_ / "floaters.ply";
+    write_test_ply(ply, splats);
+
+    SpatialGrid grid = SpatialGrid::from_files({ply}, 30.0f, 30.0f);
+    FloaterFilter filter;
+    filter.k = 8;
+    FloaterResult floaters = find_floaters(grid, {ply}, filter);
+
+    ASSERT_EQ(floaters.removed.size(), 1u);
+    EXPECT_EQ(floaters.removed[0], 3u);
+    EXPECT_EQ(floaters.drop[0][1600], 1);
+    EXPECT_EQ(floaters.drop[0][1601], 1);
+    EXPECT_EQ(floaters.drop[0][1602], 1);
+
+    grid.remove_rows({ply}, floaters.drop);
+    size_t total = 0;
+    for (const auto& [id, cell] : grid.cells()) {
+        total += cell.splat_indices[0].size();
+        EXPECT_TRUE(std::is_sorted(cell.splat_indices[0].begin(), cell.splat_indices[0].end()));
+    }
+    EXPECT_EQ(total, 1600u);
+    EXPECT_FLOAT_EQ(grid.bbox().min.x, 25.0f);
+    EXPECT_FLOAT_EQ(grid.bbox().max.y, 9.75f);
+    EXPECT_FLOAT_EQ(grid.bbox().min.z, 0.0f);
+    EXPECT_FLOAT_EQ(grid.bbox().max.z, 0.0f);
+}
+
+TEST_F(SpatialGridTest, PruneToBudgetKeepsMostImportantPerCell) {
+    // 60 splats in one cell and 20 in another; importance rises with the row
+    std::vector<Splat> splats;
+    for (int i = 0; i < 80; ++i) {
+        Splat s = make_splat(i < 60 ? 1.0f : 45.0f, 1.0f + 0.1f * static_cast<float>(i), 0.0f);
+        s.opacity = -4.0f + 0.1f * static_cast<float>(i);
+        splats.push_back(s);
+    }
+    fs::path ply = dir_ / "budget.ply";
+    write_test_ply(ply, splats);
+
+    SpatialGrid grid = SpatialGrid::from_files({ply}, 30.0f, 30.0f);
+    EXPECT_EQ(count_grid_splats(grid), 80u);
+    EXPECT_EQ(prune_to_budget(grid, {ply}, 20), 20u);
+    EXPECT_EQ(count_grid_splats(grid), 20u);
+
+    // Each cell keeps a quarter: its most important splats, in input order
+    ASSERT_EQ(grid.cells().size(), 2u);
+    std::vector<size_t> first = grid.cells().begin()->second.splat_indices[0];
+    std::vector<size_t> second = std::next(grid.cells().begin())->second.splat_indices[0];
+    std::vector<size_t> expected_first, expected_second;
+    for (size_t i = 45; i < 60; ++i) expected_first.push_back(i);
+    for (size_t i = 75; i < 80; ++i) expected_second.push_back(i);
+    EXPECT_EQ(first, expected_first);
+    EXPECT_EQ(second, expected_second);
+
+    // Already within budget: untouched
+    EXPECT_EQ(prune_to_budget(grid, {ply}, 100), 20u);
+    EXPECT_EQ(output_bytes_per_splat(true), 96u);
+    EXPECT_EQ(output_bytes_per_splat(false), 32u);
+}
+
+TEST_F(SpatialGridTest, RangePassMeasuresShEnergy) {
+    std::vector<Splat> splats;
+    for (int i = 0; i < 10; ++i) {
+        Splat s = make_splat(static_cast<float>(i), 0.0f, 0.0f);
+        for (int c = 0; c < 3; ++c) s.f_dc[c] = 1.0f;
+        for (int j = 0; j < 9; ++j) s.f_rest[j] = 0.1f;
+        splats.push_back(s);
+    }
+    fs::path ply = dir_ / "sh.ply";
+    write_test_ply(ply, splats);
+
+    SpatialGrid grid = SpatialGrid::from_files({ply}, 30.0f, 30.0f);
+    const ShEnergy& energy = grid.sh_energy();
+    EXPECT_NEAR(energy.band_ratio(1), 0.1, 1e-6);
+    EXPECT_DOUBLE_EQ(energy.band_ratio(2), 0.0);
+    EXPECT_NEAR(energy.total_ratio(), std::sqrt(0.03), 1e-6);
+    EXPECT_NEAR(energy.view_dependent_rms(), ShEnergy::SH_C0 * std::sqrt(0.03), 1e-6);
+
+    // Carried through the grid cache
+    std::string key = SpatialGrid::cache_key({ply}, 30.0f, 30.0f);
+    ASSERT_TRUE(grid.save(dir_ / "grid.cache", key));
+    auto loaded = SpatialGrid::load(dir_ / "grid.cache", key, 1);
+    ASSERT_TRUE(loaded.has_value());
+    EXPECT_DOUBLE_EQ(loaded->sh_energy().total_ratio(), energy.total_ratio());
+
+    grid.drop_sh();
+    EXPECT_FALSE(grid.has_sh());
+}
+
+TEST(SplatOrderTest, MortonInterleavesAxes) {
+    EXPECT_EQ(morton_key_3d(1, 0, 0), 1u);
+    EXPECT_EQ(morton_key_3d(0, 1, 0), 2u);
+    EXPECT_EQ(morton_key_3d(0, 0, 1), 4u);
+    EXPECT_EQ(morton_key_3d(3, 3, 3), 63u);
+    EXPECT_EQ(morton_key_3d(0x1FFFFF, 0x1FFFFF, 0x1FFFFF), (uint64_t(1) << 63) - 1);
+}
+
+TEST(SplatOrderTest, HilbertVisitsNeighboursInSequence) {
+    const int bits = 3;
+    const uint32_t side = 1u << bits;
+    std::vector<uint64_t> keys;
+    std::vector<size_t> points;
+    for (uint32_t z = 0; z < side; ++z)
+        for (uint32_t y = 0; y < side; ++y)
+            for (uint32_t x = 0; x < side; ++x) {
+                keys.push_back(hilbert_key_3d(x, y, z, bits));
+                points.push_back((z * side + y) * side + x);
+            }
+
+    radix_sort_by_key(keys, points, false);
+
+    for (size_t i = 0; i < keys.size(); ++i) {
+        ASSERT_EQ(keys[i], i);  // bijective onto [0, side^3)
+    }
+    for (size_t i = 1; i < points.size(); ++i) {
+        int ax = static_cast<int>(points[i - 1] % side), bx = static_cast<int>(points[i] % side);
+        int ay = static_cast<int>(points[i - 1] / side % side), by = static_cast<int>(points[i] / side % side);
+        int az = static_cast<int>(points[i - 1] / (side * side)), bz = static_cast<int>(points[i] / (side * side));
+        EXPECT_EQ(std::abs(ax - bx) + std::abs(ay - by) + std::abs(az - bz), 1) << "step " << i;
+    }
+}
+
+TEST(SplatOrderTest, RadixSortIsStableAndMatchesStdSort) {
+    std::vector<uint64_t> keys;
+    std::vector<size_t> values;
+    uint64_t state = 12345;
+    for (size_t i = 0; i < 5000; ++i) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        keys.push_back((state >> 20) % 997 + (uint64_t(1) << 40));
+        values.push_back(i);
+    }
+
+    std::vector<std::pair<uint64_t, size_t>> expected;
+    for (size_t i = 0; i < keys.size(); ++i) expected.emplace_back(keys[i], values[i]);
+    std::stable_sort(expected.begin(), expected.end(),
+                     [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    for (bool parallel : {false, true}) {
+        auto k = keys;
+        auto v = values;
+        radix_sort_by_key(k, v, parallel);
+        for (size_t i = 0; i < expected.size(); ++i) {
+            ASSERT_EQ(k[i], expected[i].first);
+            ASSERT_EQ(v[i], expected[i].second);
+        }
+    }
+}
+
+TEST_F(SpatialGridTest, SortCellSplatsPermutesIndices) {
+    SpatialGrid grid = SpatialGrid::from_files({ply_}, 30.0f, 30.0f);
+    SpatialGrid sorted = grid;
+    sort_cell_splats(sorted, {ply_}, SplatOrder::Hilbert);
+
+    for (const auto& [id, cell] : grid.cells()) {
+        auto original = cell.splat_indices[0];
+        auto reordered = sorted.cells().at(id).splat_indices[0];
+        std::sort(original.begin(), original.end());
+        std::sort(reordered.begin(), reordered.end());
+        EXPECT_EQ(original, reordered);
+    }
+}
+
+TEST_F(SpatialGridTest, ImportanceOrderIsDescending) {
+    std::vector<Splat> splats;
+    for (int i = 0; i < 100; ++i) {
+        Splat s = make_splat(1.0f + 0.01f * static_cast<float>(i), 1.0f, 0.0f);
+        s.opacity = static_cast<float>((i * 37) % 11) - 5.0f;
+        s.scale = Vec3f(-4.0f + 0.03f * static_cast<float>((i * 13) % 17), -3.0f, -3.0f);
+        splats.push_back(s);
+    }
+    fs::path ply = dir_ / "importance.ply";
+    write_test_ply(ply, splats);
+
+    SpatialGrid grid = SpatialGrid::from_files({ply}, 30.0f, 30.0f);
+    sort_cell_splats(grid, {ply}, SplatOrder::Importance);
+
+    SplatBuffer buffer;
+    ASSERT_TRUE(buffer.initialize(ply));
+    ASSERT_EQ(grid.cells().size(), 1u);
+    const auto& indices = grid.cells().begin()->second.splat_indices[0];
+    ASSERT_EQ(indices.size(), 100u);
+    for (size_t i = 1; i < indices.size(); ++i) {
+        EXPECT_GE(splat_importance(buffer[indices[i - 1]]), splat_importance(buffer[indices[i]]));
+    }
+}
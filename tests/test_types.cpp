@@ -1,6 +1,13 @@
 #include <gtest/gtest.h>
 #include "types.hpp"
+#include "hash.hpp"
+#include "lcc_types.hpp"
+#include "convert_app.hpp"
+#include <algorithm>
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
 
 using namespace ply2lcc;
 
@@ -228,16 +235,280 @@ TEST(ConvertConfigTest, DefaultValues) {
     EXPECT_FLOAT_EQ(config.cell_size_y, 30.0f);
 }
 
+TEST(ConvertConfigTest, WorkersNeedExecutable) {
+    ConvertConfig config;
+    config.input_path = "point_cloud.ply";
+    config.output_dir = "out";
+    config.workers = 4;
+    EXPECT_THROW(ConvertApp app(config), std::runtime_error);  // Rejected before any work
+    config.worker_executable = "ply2lcc";
+    EXPECT_NO_THROW(ConvertApp app(config));
+}
+
 // ThreadLocalGrid tests
 TEST(ThreadLocalGridTest, AddAndAccess) {
     ThreadLocalGrid grid;
 
-    grid.cell_indices[0x00010002].push_back(100);
-    grid.cell_indices[0x00010002].push_back(200);
-    grid.cell_indices[0x00030004].push_back(300);
+    for (auto [cell_id, row] : {std::pair<uint32_t, uint64_t>{0x00010002, 100}, {0x00010002, 200}, {0x00030004, 300}}) {
+        grid.cell_ids.push_back(cell_id);
+        grid.rows.push_back(row);
+    }
+
+    ASSERT_EQ(grid.cell_ids.size(), grid.rows.size());
+    EXPECT_EQ(std::count(grid.cell_ids.begin(), grid.cell_ids.end(), 0x00010002u), 2);
+    EXPECT_EQ(grid.rows[0], 100u);
+    EXPECT_TRUE(std::is_sorted(grid.cell_ids.begin(), grid.cell_ids.end()));
+}
+
+// QuantileSketch tests
+TEST(QuantileSketchTest, RangeDropsTails) {
+    QuantileSketch sketch;
+    for (int i = 1; i <= 1000; ++i) {
+        sketch.add(static_cast<float>(i) * 0.01f - 2.0f);  // -1.99 .. 8.0
+    }
+    sketch.add(1e6f);
+    sketch.add(-5e5f);
+    sketch.add(std::nanf(""));
+    EXPECT_EQ(sketch.count(), 1002u);
+
+    // No tail: full range, rounded outward to ~3% buckets
+    auto [lo0, hi0] = sketch.range(0.0);
+    EXPECT_LE(lo0, -5e5f);
+    EXPECT_GE(hi0, 1e6f);
+
+    // 1% tails drop both outliers
+    auto [lo, hi] = sketch.range(0.01);
+    EXPECT_LE(lo, -1.99f + 0.09f);
+    EXPECT_GE(lo, -1.99f * 1.04f);
+    EXPECT_GE(hi, 8.0f - 0.09f);
+    EXPECT_LE(hi, 8.0f * 1.04f);
+}
+
+TEST(QuantileSketchTest, MergeMatchesSingleSketch) {
+    QuantileSketch a, b, all;
+    for (int i = 0; i < 500; ++i) {
+        float v = std::sin(static_cast<float>(i)) * 10.0f;
+        (i % 2 ? a : b).add(v);
+        all.add(v);
+    }
+    a.merge(b);
+    EXPECT_EQ(a.count(), all.count());
+    EXPECT_EQ(a.range(0.05), all.range(0.05));
+}
+
+// XXH64 tests (reference values from the xxHash project)
+TEST(XXH64Test, ReferenceVectors) {
+    EXPECT_EQ(XXH64::hash("", 0), 0xEF46DB3751D8E999ULL);
+    EXPECT_EQ(XXH64::hash("a", 1), 0xD24EC4F1A98C6E5BULL);
+    EXPECT_EQ(XXH64::hash("abc", 3), 0x44BC2CF5AD770999ULL);
+
+    const char* long_input = "Nobody inspects the spammish repetition";
+    EXPECT_EQ(XXH64::hash(long_input, std::strlen(long_input)), 0xFBCEA83C8A378BF1ULL);
+}
+
+TEST(XXH64Test, StreamingMatchesOneShot) {
+    std::string input;
+    for (int i = 0; i < 300; ++i) input += static_cast<char>('a' + i % 26);
+
+    XXH64 h(42);
+    for (size_t pos = 0; pos < input.size(); pos += 7) {
+        h.update(input.data() + pos, std::min<size_t>(7, input.size() - pos));
+    }
+    EXPECT_EQ(h.digest(), XXH64::hash(input.data(), input.size(), 42));
+}
+
+// LccData cell layout tests
+static LccData make_cell_grid(uint32_t side, CellLayout layout) {
+    LccData data;
+    data.num_lods = 2;
+    data.cell_layout = layout;
+    for (uint32_t y = 0; y < side; ++y) {
+        for (uint32_t x = 0; x < side; ++x) {
+            for (size_t lod = 0; lod < 2; ++lod) {
+                data.cells.emplace_back((y << 16) | x, 1 - lod);
+                data.cells.back().count = 1;
+            }
+        }
+    }
+    data.sort_cells();
+    return data;
+}
+
+TEST(LccDataTest, ColumnLayoutSortsByXThenY) {
+    LccData data = make_cell_grid(4, CellLayout::Column);
+    ASSERT_EQ(data.cells.size(), 32u);
+    EXPECT_EQ(data.cells[0].cell_id, 0u);
+    EXPECT_EQ(data.cells[0].lod, 0u);
+    EXPECT_EQ(data.cells[1].lod, 1u);
+    EXPECT_EQ(data.cells[2].cell_id, 1u << 16);  // (x=0, y=1)
+    EXPECT_EQ(data.cells[8].cell_id, 1u);        // (x=1, y=0)
+}
+
+TEST(LccDataTest, HilbertLayoutKeepsNeighboursAdjacent) {
+    LccData data = make_cell_grid(8, CellLayout::Hilbert);
+    for (size_t i = 2; i < data.cells.size(); i += 2) {
+        int ax = static_cast<int>(data.cells[i - 2].cell_id & 0xFFFF);
+        int ay = static_cast<int>(data.cells[i - 2].cell_id >> 16);
+        int bx = static_cast<int>(data.cells[i].cell_id & 0xFFFF);
+        int by = static_cast<int>(data.cells[i].cell_id >> 16);
+        EXPECT_EQ(std::abs(ax - bx) + std::abs(ay - by), 1) << "step " << i / 2;
+        EXPECT_EQ(data.cells[i].cell_id, data.cells[i + 1].cell_id);
+    }
+}
+
+TEST(LccDataTest, ZOrderLayoutVisitsQuadrantsInTurn) {
+    LccData data = make_cell_grid(4, CellLayout::ZOrder);
+    // The first four units form the 2x2 block at the origin
+    std::vector<uint32_t> first;
+    for (size_t i = 0; i < 8; i += 2) first.push_back(data.cells[i].cell_id);
+    EXPECT_EQ(first, (std::vector<uint32_t>{0u, 1u, 1u << 16, (1u << 16) | 1u}));
+
+    uint64_t data_offset = 0, sh_offset = 0;
+    auto units = data.build_index(data_offset, sh_offset);
+    EXPECT_EQ(units.size(), 16u);
+}
+
+TEST(LccDataTest, LodMajorGroupsCoarsestLodFirst) {
+    LccData data;
+    data.num_lods = 2;
+    data.lod_major = true;
+    data.cells.emplace_back(2u, 0);
+    data.cells.emplace_back(1u, 0);
+    data.cells.emplace_back(1u, 1);
+    data.cells.emplace_back(2u, 1);
+    for (auto& cell : data.cells) {
+        cell.count = cell.lod == 0 ? 4 : 1;
+        cell.data.resize(cell.count * 32);
+    }
+    data.sort_cells();
+
+    ASSERT_EQ(data.cells.size(), 4u);
+    EXPECT_EQ(data.cells[0].lod, 1u);
+    EXPECT_EQ(data.cells[0].cell_id, 1u);
+    EXPECT_EQ(data.cells[1].lod, 1u);
+    EXPECT_EQ(data.cells[2].lod, 0u);
+
+    uint64_t data_offset = 0, sh_offset = 0;
+    auto units = data.build_index(data_offset, sh_offset);
+    ASSERT_EQ(units.size(), 2u);
+    EXPECT_EQ(units[0].index, 1u);
+    EXPECT_EQ(units[0].lods[1].data_offset, 0u);
+    EXPECT_EQ(units[1].lods[1].data_offset, 32u);
+    EXPECT_EQ(units[0].lods[0].data_offset, 64u);
+    EXPECT_EQ(units[1].lods[0].data_offset, 64u + 128u);
+    EXPECT_EQ(data_offset, 64u + 256u);
+}
+
+TEST(RegionTest, PolygonUsesEvenOddRule) {
+    // U shape: the notch between the arms is outside
+    Region region;
+    region.polygon = {{{0, 0}}, {{3, 0}}, {{3, 3}}, {{2, 3}}, {{2, 1}}, {{1, 1}}, {{1, 3}}, {{0, 3}}};
+    EXPECT_TRUE(region.enabled());
+    EXPECT_TRUE(region.contains(Vec3f(0.5f, 2.5f, 100.0f)));
+    EXPECT_TRUE(region.contains(Vec3f(2.5f, 2.5f, -100.0f)));
+    EXPECT_TRUE(region.contains(Vec3f(1.5f, 0.5f, 0.0f)));
+    EXPECT_FALSE(region.contains(Vec3f(1.5f, 2.0f, 0.0f)));
+    EXPECT_FALSE(region.contains(Vec3f(4.0f, 0.5f, 0.0f)));
+
+    region.min_z = 0.0f;
+    region.max_z = 1.0f;
+    EXPECT_FALSE(region.contains(Vec3f(0.5f, 2.5f, 1.0f)));
+    EXPECT_TRUE(region.contains(Vec3f(0.5f, 2.5f, 0.0f)));
+    EXPECT_FALSE(Region().enabled());
+}
+
+// SplatTransform tests
+static SplatTransform rotation_about_z_90() {
+    const double m[16] = {0, -1, 0, 0,
+                          1, 0, 0, 0,
+                          0, 0, 1, 0,
+                          0, 0, 0, 1};
+    return SplatTransform::from_matrix(m);
+}
+
+TEST(SplatTransformTest, DecomposesScaleAndTranslation) {
+    const double m[16] = {0, 0, 2, 500000.5,
+                          2, 0, 0, 4000000.25,
+                          0, 2, 0, -12,
+                          0, 0, 0, 1};
+    SplatTransform t = SplatTransform::from_matrix(m);
+    EXPECT_DOUBLE_EQ(t.scale, 2.0);
+    EXPECT_DOUBLE_EQ(t.translation[0], 500000.5);
+    EXPECT_DOUBLE_EQ(t.translation[1], 4000000.25);
+    EXPECT_TRUE(t.rotates());
+
+    // Positions are rotated only; the quaternion agrees with the matrix
+    Vec3f p = t.apply_pos(Vec3f(1.0f, 2.0f, 3.0f));
+    EXPECT_FLOAT_EQ(p.x, 3.0f);
+    EXPECT_FLOAT_EQ(p.y, 1.0f);
+    EXPECT_FLOAT_EQ(p.z, 2.0f);
+    const Quat& q = t.rotation_quat;
+    const float vx = 1.0f, vy = 2.0f, vz = 3.0f;
+    // v' = v + 2w (u x v) + 2 u x (u x v)
+    const float cx = q.y * vz - q.z * vy, cy = q.z * vx - q.x * vz, cz = q.x * vy - q.y * vx;
+    EXPECT_NEAR(vx + 2 * (q.w * cx + q.y * cz - q.z * cy), p.x, 1e-5f);
+    EXPECT_NEAR(vy + 2 * (q.w * cy + q.z * cx - q.x * cz), p.y, 1e-5f);
+    EXPECT_NEAR(vz + 2 * (q.w * cz + q.x * cy - q.y * cx), p.z, 1e-5f);
+
+    Quat composed = t.apply_rot(Quat());
+    EXPECT_FLOAT_EQ(composed.w, q.w);
+    EXPECT_FLOAT_EQ(composed.x, q.x);
+}
+
+TEST(SplatTransformTest, RejectsShearMirrorAndProjection) {
+    const double shear[16] = {1, 0.5, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+    const double mirror[16] = {-1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+    const double projective[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 1, 1};
+    EXPECT_THROW(SplatTransform::from_matrix(shear), std::runtime_error);
+    EXPECT_THROW(SplatTransform::from_matrix(mirror), std::runtime_error);
+    EXPECT_THROW(SplatTransform::from_matrix(projective), std::runtime_error);
+
+    const double identity[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+    EXPECT_FALSE(SplatTransform::from_matrix(identity).enabled());
+}
+
+TEST(SplatTransformTest, RotatesShBandOneLikeADirection) {
+    // Band 1 is (-y, z, -x) up to a constant: a 90 degree turn about z maps
+    // x to y, so the coefficients (c0, c1, c2) become (c2, c1, -c0)
+    SplatTransform t = rotation_about_z_90();
+    float f_rest[9] = {0.1f, 0.2f, 0.3f,  1, 2, 3,  -1, -2, -3};
+    t.apply_sh(f_rest, 9);
+    EXPECT_NEAR(f_rest[0], 0.3f, 1e-5f);
+    EXPECT_NEAR(f_rest[1], 0.2f, 1e-5f);
+    EXPECT_NEAR(f_rest[2], -0.1f, 1e-5f);
+    EXPECT_NEAR(f_rest[3], 3.0f, 1e-5f);   // Each channel separately
+    EXPECT_NEAR(f_rest[8], 1.0f, 1e-5f);
+}
+
+TEST(SplatTransformTest, ShRotationIsOrthogonalPerBand) {
+    const double m[16] = {0.36, 0.48, -0.8, 0,
+                          -0.8, 0.6, 0, 0,
+                          0.48, 0.64, 0.6, 0,
+                          0, 0, 0, 1};
+    SplatTransform t = SplatTransform::from_matrix(m);
+    float f_rest[45];
+    for (int i = 0; i < 45; ++i) f_rest[i] = std::sin(0.7f * static_cast<float>(i) + 0.3f);
+    float rotated[45];
+    std::memcpy(rotated, f_rest, sizeof(f_rest));
+    t.apply_sh(rotated, 45);
+
+    // Band energy is preserved; the coefficients themselves change
+    const int bands[3][2] = {{0, 3}, {3, 8}, {8, 15}};
+    for (int c = 0; c < 3; ++c) {
+        for (const auto& band : bands) {
+            float before = 0.0f, after = 0.0f;
+            for (int k = band[0]; k < band[1]; ++k) {
+                before += f_rest[c * 15 + k] * f_rest[c * 15 + k];
+                after += rotated[c * 15 + k] * rotated[c * 15 + k];
+            }
+            EXPECT_NEAR(before, after, 1e-4f);
+        }
+    }
+    EXPECT_GT(std::abs(rotated[10] - f_rest[10]), 1e-3f);
 
-    EXPECT_EQ(grid.cell_indices.size(), 2u);
-    EXPECT_EQ(grid.cell_indices[0x00010002].size(), 2u);
-    EXPECT_EQ(grid.cell_indices[0x00010002][0], 100u);
-    EXPECT_EQ(grid.cell_indices[0x00030004].size(), 1u);
+    // Four quarter turns about z are the identity
+    SplatTransform quarter = rotation_about_z_90();
+    std::memcpy(rotated, f_rest, sizeof(f_rest));
+    for (int i = 0; i < 4; ++i) quarter.apply_sh(rotated, 45);
+    for (int i = 0; i < 45; ++i) EXPECT_NEAR(rotated[i], f_rest[i], 1e-4f);
 }